@@ -0,0 +1,94 @@
+#include "Arena.h"
+#include <cstring>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+/*
+ * Creates empty arena. Memory is taken in blocks
+ * as it's needed and is only given back when
+ * arena is destroyed.
+ */
+Arena::Arena(){
+
+    blocks = nullptr;
+    current = nullptr;
+    remaining = 0;
+}
+
+/*
+ * Frees all blocks at once. Destructors of objects
+ * placed in arena are not called, so only objects
+ * that don't own other memory should be kept here.
+ */
+Arena::~Arena(){
+
+    while(blocks){
+        Block *next = blocks->next;
+        free(blocks);
+        blocks = next;
+    }
+}
+
+/*
+ * Returns size bytes aligned to alignment, which
+ * must be a power of two. Requests that don't fit
+ * in a block get a block of their own.
+ */
+void* Arena::allocate(size_t size, size_t alignment){
+
+    size_t padding = (alignment - (size_t)current % alignment) & (alignment - 1);
+    if(current == nullptr || padding + size > remaining){
+        size_t blockSize = size + alignment > BLOCK_SIZE ? size + alignment : BLOCK_SIZE;
+        Block *block = (Block*)malloc(sizeof(Block) + blockSize);
+        if(block == nullptr) throw bad_alloc();
+        block->next = blocks;
+        block->size = blockSize;
+        blocks = block;
+        current = (char*)(block + 1);
+        remaining = blockSize;
+        padding = (alignment - (size_t)current % alignment) & (alignment - 1);
+    }
+    char *result = current + padding;
+    current = result + size;
+    remaining -= padding + size;
+    return result;
+}
+
+/*
+ * Copies name into arena as a zero terminated
+ * string.
+ */
+char* Arena::copyString(const char* name, int length){
+
+    char *copy = (char*)allocate(length + 1, 1);
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+/*
+ * Forgets everything allocated so far. One block
+ * of the usual size is kept for what comes next,
+ * so an arena that is reset for every small input
+ * doesn't allocate again.
+ */
+void Arena::reset(){
+
+    Block *kept = nullptr;
+    while(blocks){
+        Block *next = blocks->next;
+        if(kept == nullptr && blocks->size == BLOCK_SIZE) kept = blocks;
+        else free(blocks);
+        blocks = next;
+    }
+    blocks = kept;
+    current = nullptr;
+    remaining = 0;
+    if(kept){
+        kept->next = nullptr;
+        current = (char*)(kept + 1);
+        remaining = kept->size;
+    }
+}
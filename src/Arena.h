@@ -0,0 +1,40 @@
+#ifndef ARENA
+#define ARENA
+
+#include <cstddef>
+
+using namespace std;
+
+class Arena{
+
+public:
+
+    Arena();
+
+    ~Arena();
+
+    void* allocate(size_t, size_t);
+
+    char* copyString(const char*, int);
+
+    void reset();
+
+private:
+
+    struct Block{
+        Block *next;
+        size_t size;
+    };
+
+    static const size_t BLOCK_SIZE = 1 << 16;
+
+    Block *blocks;
+    char *current;
+    size_t remaining;
+
+    Arena(const Arena&);
+
+    Arena& operator=(const Arena&);
+};
+
+#endif
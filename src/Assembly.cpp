@@ -8,27 +8,60 @@
 #include "StringTokenizer.h"
 #include <iostream>
 #include <cstdlib>
-#include <sstream>
 #include "RelocationTable.h"
+#include "MachineCode.h"
+#include "ObjectFileWriter.h"
+#include "OutputBuffer.h"
+#include "Encoding.h"
+#include "Statistics.h"
+#include "IncrementalCache.h"
+#include "EncodingCache.h"
+#include "Chunk.h"
+#include <thread>
+#include <atomic>
+#include <exception>
 
 using namespace std;
 
+/*
+ * Creates assembly that works on input in memory,
+ * given to assemble. Results are read through
+ * getters and no output file is written.
+ */
+Assembly::Assembly(){
+
+	this->inputFileName = nullptr;
+	this->outputFileName = nullptr;
+	this->output = nullptr;
+	this->symbolTable = new SymbolTable();
+	this->endOfProgram = false;
+	this->completeSections = 0;
+	this->binaryOutput = false;
+	this->numberOfThreads = 1;
+	this->statistics = nullptr;
+	this->cacheFileName = nullptr;
+	this->pipeline = false;
+	this->outputWritten = false;
+	this->encodedSections = nullptr;
+}
+
 /* Creates new instance of assembly analyzer
  * that takes name of input and output file.
+ * Name "-" means standard input or output.
  */
-Assembly::Assembly(char *inputFileName, char *outputFileName){
+Assembly::Assembly(const char *inputFileName, const char *outputFileName) : Assembly(){
 
     this->inputFileName = inputFileName;
-    inputFileStream.open(inputFileName, fstream::in);
-	if(!inputFileStream.is_open()) throw Error(0);
+    if(!inputFile.open(inputFileName)) throw Error(0);
 
 	this->outputFileName = outputFileName;
-	outputFileStream.open(outputFileName, fstream::out);
+	if(strcmp(outputFileName, "-") == 0){
+	    output = &cout;
+	    return;
+	}
+	outputFileStream.open(outputFileName, fstream::out | fstream::binary);
 	if(!outputFileStream.is_open()) throw Error(1);
-
-	this->symbolTable = new SymbolTable();
-	this->endOfProgram = false;
-	this->rTables = nullptr;
+	output = &outputFileStream;
 }
 
 /*
@@ -37,44 +70,176 @@ Assembly::Assembly(char *inputFileName, char *outputFileName){
  */
 Assembly::~Assembly(){
 
-    if(inputFileStream.is_open()) inputFileStream.close();
+    inputFile.close();
     if(outputFileStream.is_open()) outputFileStream.close();
-    for(int i = 0; i < symbolTable->getLastSectionID(); i++) delete rTables[i];
-    delete rTables;
+    for(unsigned int i = 0; i < rTables.size(); i++) delete rTables[i];
     delete symbolTable;
 }
 
 /*
- * This method reads one line from input file
- * until it reaches end of file. In that case
- * it returns null pointer.
+ * Assembles source held in memory, doing both
+ * passes. Assembly can be used for any number of
+ * sources one after another: input buffer, symbol
+ * table, statements, section code and relocation
+ * tables keep their memory from one source to the
+ * next. Results stay valid until the next call.
+ */
+void Assembly::assemble(const char* source, long size){
+
+    inputFile.assign(source, size);
+    symbolTable->clear();
+    statements.clear();
+    relocationHints.clear();
+    endOfProgram = false;
+    completeSections = 0;
+    outputWritten = false;
+    firstPass();
+    secondPass();
+}
+
+/*
+ * Sections are numbered from zero here, which is
+ * section number one in the symbol table. All
+ * sections are included, even the last one when
+ * it isn't ended by .end.
  */
-char* Assembly::readLine(){
+int Assembly::getNumberOfSections(){
+
+    return symbolTable->getLastSectionID();
+}
+
+MachineCode& Assembly::getSectionCode(int i){
+
+    return sectionCode[i + 1];
+}
+
+RelocationTable* Assembly::getRelocationTable(int i){
 
-    char *newLine = new char[LINE_LENGTH];
-    if(!inputFileStream.eof()){
-        inputFileStream.getline(newLine, 100);
-        char *line = new char[strlen(newLine) + 1];
-        strcpy(line, newLine);
-        delete [] newLine;
-        return line;
-    } else return NULL;
+    return rTables[i];
 }
 
 /*
- * This method creates a .txt variant of
- * described elf format used in class.
+ * Symbols, sections first, are listed from
+ * getFirst of the symbol table.
+ */
+SymbolTable* Assembly::getSymbolTable(){
+
+    return symbolTable;
+}
+
+/*
+ * This method writes result of the second pass.
+ * Text output is a .txt variant of described elf
+ * format used in class: machine code of sections
+ * that were ended by another section or .end,
+ * relocation tables and symbol table. Binary
+ * output holds the same data in compact form.
  */
 void Assembly::createOutputFile(){
 
-    symbolTable->saveToFile(outputFileStream);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int numberOfSections = symbolTable->getLastSectionID();
+
+    if(outputWritten){
+        /* pipelined second pass has written everything already */
+    }else if(binaryOutput){
+        ObjectFileWriter writer;
+        for(int i = 0; i < numberOfSections; i++) writer.addSection(sectionCode[i + 1], rTables[i]);
+        writer.setSymbolTable(symbolTable);
+        writer.writeToFile(*output);
+    }else{
+        for(int i = 0; i < completeSections; i++)
+            writeMachineCodeToFile(sectionCode[i + 1], rTables[i]->getSectionName());
+        for(int i = 0; i < numberOfSections; i++){
+            rTables[i]->writeTableToFile(outputBuffer);
+            writeOutputBuffer();
+        }
+        symbolTable->saveToFile(outputBuffer);
+        writeOutputBuffer();
+    }
+    output->flush();
+
+    if(statistics){
+        if(!outputWritten) statistics->outputTime = Statistics::elapsed(start);
+        /* a pipe has no position, its bytes are not counted */
+        long position = output->tellp();
+        if(position >= 0) statistics->outputBytes = position;
+        if(binaryOutput) statistics->writeTime = statistics->outputTime;
+        statistics->allocations = Statistics::getAllocations() - statistics->allocations;
+        statistics->allocatedBytes = Statistics::getAllocatedBytes() - statistics->allocatedBytes;
+    }
+
+    /* output is closed here, so a failed write is an error and not a short file */
+    if(output == &outputFileStream) outputFileStream.close();
+    if(output->fail()) throw Error(23);
+}
+
+/*
+ * Writes what was formatted into output buffer
+ * with one call.
+ */
+void Assembly::writeOutputBuffer(){
+
+    if(statistics == nullptr){
+        outputBuffer.writeToFile(*output);
+        return;
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    outputBuffer.writeToFile(*output);
+    statistics->writeTime += Statistics::elapsed(start);
+}
+
+/*
+ * Sets how many threads second pass may use.
+ */
+void Assembly::setNumberOfThreads(int numberOfThreads){
+
+    this->numberOfThreads = numberOfThreads;
+}
+
+/*
+ * Turns on collecting of timings and counters
+ * into given statistics, or off for nullptr.
+ */
+void Assembly::setStatistics(Statistics* statistics){
+
+    this->statistics = statistics;
+    symbolTable->setStatistics(statistics);
+    if(statistics){
+        statistics->threads = numberOfThreads;
+        statistics->allocations = Statistics::getAllocations();
+        statistics->allocatedBytes = Statistics::getAllocatedBytes();
+    }
+}
+
+/*
+ * Turns on incremental mode: results of second
+ * pass are kept in given file and sections that
+ * didn't change are taken from it next time.
+ */
+void Assembly::setCacheFile(const char* cacheFileName){
+
+    this->cacheFileName = cacheFileName;
 }
 
 /*
- * This constant represents longest line that
- * can be read from input file.
+ * Turns on pipelined mode: text output is formatted
+ * and written on other threads while second pass
+ * encodes the following sections.
  */
-const int Assembly::LINE_LENGTH = 101;
+void Assembly::setPipeline(bool pipeline){
+
+    this->pipeline = pipeline;
+}
+
+/*
+ * Chooses between text (default) and binary
+ * output format.
+ */
+void Assembly::setBinaryOutput(bool binaryOutput){
+
+    this->binaryOutput = binaryOutput;
+}
 
 /*
  * Array containing all possible directives used in
@@ -156,56 +321,226 @@ const int Assembly::MNEMONIC = 10;
 const int Assembly::REGISTER = 11;
 const int Assembly::CONSTANT = 12;
 
+/*
+ * This method maps name of directive (without the
+ * leading dot) to its token type, or returns zero
+ * if it is not a directive. Names are dispatched on
+ * their first character, so at most two comparisons
+ * are made.
+ */
+int Assembly::lookupDirective(const char* name, int length){
+
+    switch(name[0]){
+    case 'p':
+        return matches(name, length, "public") ? PUBLIC : 0;
+    case 'e':
+        if(matches(name, length, "extern")) return EXTERN;
+        return matches(name, length, "end") ? END : 0;
+    case 'c':
+        return matches(name, length, "char") ? CHAR : 0;
+    case 'w':
+        return matches(name, length, "word") ? WORD : 0;
+    case 'l':
+        return matches(name, length, "long") ? LONG : 0;
+    case 'a':
+        return matches(name, length, "align") ? ALIGN : 0;
+    case 's':
+        return matches(name, length, "skip") ? SKIP : 0;
+    }
+    return 0;
+}
+
+/*
+ * This method checks if token of given length
+ * is equal to zero terminated string.
+ */
+bool Assembly::matches(const char* token, int length, const char* word){
+
+    return (int)strlen(word) == length && memcmp(token, word, length) == 0;
+}
+
+/*
+ * This method returns index of condition that
+ * makes the rest of the mnemonic, or -1 if the
+ * rest is not exactly one condition.
+ */
+int Assembly::lookupCondition(const char* suffix, int length){
+
+    if(length != 2) return -1;
+    switch(suffix[0]){
+    case 'e':
+        return suffix[1] == 'q' ? 0 : -1;
+    case 'n':
+        return suffix[1] == 'e' ? 1 : -1;
+    case 'g':
+        if(suffix[1] == 't') return 2;
+        return suffix[1] == 'e' ? 3 : -1;
+    case 'l':
+        if(suffix[1] == 't') return 4;
+        return suffix[1] == 'e' ? 5 : -1;
+    case 'a':
+        return suffix[1] == 'l' ? 6 : -1;
+    }
+    return -1;
+}
+
+/*
+ * This method walks a trie of instruction names
+ * hardcoded as nested switches, and then matches
+ * the condition. It returns index of token in
+ * mnemonics array (instruction * 7 + condition),
+ * or -1 if token is not a mnemonic. Cost of lookup
+ * depends only on length of the token.
+ */
+int Assembly::lookupMnemonic(const char* token, int length){
+
+    /* shortest mnemonic is instruction "or" plus condition */
+    if(length < 4) return -1;
+
+    int instruction = -1;
+    int nameLength = 0;
+
+    switch(token[0]){
+    case 'a':
+        if(token[1] == 'd' && token[2] == 'd') instruction = 1;
+        else if(token[1] == 'n' && token[2] == 'd') instruction = 6;
+        nameLength = 3;
+        break;
+    case 's':
+        if(token[1] == 'u' && token[2] == 'b') instruction = 2;
+        else if(token[1] == 't' && token[2] == 'r') instruction = 11;
+        else if(token[1] == 'h' && token[2] == 'r') instruction = 16;
+        else if(token[1] == 'h' && token[2] == 'l') instruction = 17;
+        nameLength = 3;
+        break;
+    case 'm':
+        if(token[1] == 'u' && token[2] == 'l') instruction = 3;
+        else if(token[1] == 'o' && token[2] == 'v') instruction = 15;
+        nameLength = 3;
+        break;
+    case 'd':
+        if(token[1] == 'i' && token[2] == 'v') instruction = 4;
+        nameLength = 3;
+        break;
+    case 'c':
+        if(token[1] == 'm' && token[2] == 'p'){
+            instruction = 5;
+            nameLength = 3;
+        }else if(token[1] == 'a' && token[2] == 'l' && token[3] == 'l'){
+            instruction = 12;
+            nameLength = 4;
+        }
+        break;
+    case 'o':
+        if(token[1] == 'r'){
+            instruction = 7;
+            nameLength = 2;
+        }else if(token[1] == 'u' && token[2] == 't'){
+            instruction = 14;
+            nameLength = 3;
+        }
+        break;
+    case 'n':
+        if(token[1] == 'o' && token[2] == 't') instruction = 8;
+        nameLength = 3;
+        break;
+    case 't':
+        if(token[1] == 'e' && token[2] == 's' && token[3] == 't') instruction = 9;
+        nameLength = 4;
+        break;
+    case 'i':
+        if(token[1] != 'n') break;
+        /* no condition starts with 't', so "int" can't be "in" + condition */
+        if(token[2] == 't'){
+            instruction = 0;
+            nameLength = 3;
+        }else{
+            instruction = 13;
+            nameLength = 2;
+        }
+        break;
+    case 'l':
+        if(token[1] != 'd') break;
+        if(token[2] == 'r'){
+            instruction = 10;
+            nameLength = 3;
+        }else if(token[2] == 'c'){
+            /* "ldclt" and "ldcle" are ldc with condition, not ldcl */
+            if(lookupCondition(token + 3, length - 3) >= 0){
+                instruction = 20;
+                nameLength = 3;
+            }else if(token[3] == 'h'){
+                instruction = 18;
+                nameLength = 4;
+            }else if(token[3] == 'l'){
+                instruction = 19;
+                nameLength = 4;
+            }
+        }
+        break;
+    }
+
+    if(instruction < 0 || nameLength > length) return -1;
+    int condition = lookupCondition(token + nameLength, length - nameLength);
+    if(condition < 0) return -1;
+    return instruction * NUMBER_OF_CONDITIONS + condition;
+}
+
 /*
  * This method takes token as an argument and
  * determines type of legal expression in
  * described assembly language or returns zero
  * if expression is not valid.
  */
-int Assembly::determineTypeOfToken(char* token){
+int Assembly::determineTypeOfToken(const Token& token){
 
-    if(token == nullptr) return 0;
+    int mnemonicNo;
+    return determineTypeOfToken(token, mnemonicNo);
+}
 
-    if(token[0] == '.'){
+/*
+ * Same as above, but when token is a mnemonic its
+ * index in mnemonics array is also stored in the
+ * second argument, so callers don't have to look
+ * it up again.
+ */
+int Assembly::determineTypeOfToken(const Token& token, int& mnemonicNo){
+
+    mnemonicNo = -1;
+    if(!token) return 0;
 
-        /* check if end of program is reached */
-        if(strcmp(token + 1, "end") == 0) return END;
+    if(token[0] == '.'){
 
-        /* check if token is directive */
-        for(int i = 0; i < NUMBER_OF_DIRECTIVES; i++)
-            if(strcmp(directives[i], token + 1) == 0) return i + 1;
+        /* check if token is directive or end of program */
+        int directive = lookupDirective(token.start + 1, token.length - 1);
+        if(directive != 0) return directive;
 
         /* check if token is section */
         for(int i = 0; i < NUMBER_OF_SECTIONS; i++){
-            bool isSection = true;
-            for(unsigned int j = 0; j < strlen(sections[i]); j++){
-                if(sections[i][j] != token[j + 1]){
-                    isSection = false;
-                    break;
-                }
-            }
-            if(isSection) return SECTION;
+            int sectionLength = strlen(sections[i]);
+            if(token.length - 1 >= sectionLength && memcmp(sections[i], token.start + 1, sectionLength) == 0) return SECTION;
         }
 
         throw Error(2);
     }
 
     /* check if token is valid mnemonic */
-    for(int i = 0; i < NUMBER_OF_MNEMONICS; i++) if(strcmp(token, mnemonics[i]) == 0) return MNEMONIC;
+    mnemonicNo = lookupMnemonic(token.start, token.length);
+    if(mnemonicNo >= 0) return MNEMONIC;
 
     /* check if token is register */
     if(token[0] == 'r' || token[0] == 'R'){
-        int x = atoi(token + 1);
+        int x = token.parseNumber(1);
         if(x < 0 || x > 19) throw Error(13);
         return REGISTER;
     }
     /* check if token is constant */
     if(token[0] == '#'){
-        unsigned int i;
-        if(token[1] == '-') i = 2;
+        int i;
+        if(token.length > 1 && token[1] == '-') i = 2;
         else i = 1;
-        if(i == 2 && token[2] == '\0') throw Error(14);
-        for(; i < strlen(token); i++) if(!isdigit(token[i])) throw Error(14);
+        if(i == 2 && token.length == 2) throw Error(14);
+        for(; i < token.length; i++) if(!isdigit(token[i])) throw Error(14);
         return CONSTANT;
     }
     return 0;
@@ -215,36 +550,139 @@ int Assembly::determineTypeOfToken(char* token){
  * This method goes through input file
  * and creates symbol table and everything
  * else that should be created in the first
- * pass of assembly.
+ * pass of assembly. Every line that isn't
+ * just labels is recorded as a statement,
+ * which is all the second pass needs.
+ * Large files are split into chunks of lines
+ * that are scanned on different threads and
+ * then put together in order.
  */
 void Assembly::firstPass(){
 
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long size = inputFile.getSize();
+    long numberOfChunks = 1;
+    if(numberOfThreads > 1){
+        numberOfChunks = size / MINIMUM_CHUNK_SIZE;
+        if(numberOfChunks > numberOfThreads * CHUNKS_PER_THREAD) numberOfChunks = numberOfThreads * CHUNKS_PER_THREAD;
+        if(numberOfChunks < 1) numberOfChunks = 1;
+    }
+
+    /* chunks keep their memory for the next input */
+    chunks.resize(numberOfChunks);
+    for(long i = 0; i < numberOfChunks; i++){
+        chunks[i].statements.clear();
+        chunks[i].segments.clear();
+        chunks[i].events.clear();
+        chunks[i].eventsBeforeError = 0;
+        chunks[i].error = nullptr;
+        chunks[i].begin = inputFile.findLineStart(size * i / numberOfChunks);
+        chunks[i].end = inputFile.findLineStart(size * (i + 1) / numberOfChunks);
+    }
+
+    if(numberOfChunks == 1) scanChunk(chunks[0]);
+    else{
+        atomic<long> nextChunk(0);
+        auto worker = [&](){
+            for(long k = nextChunk++; k < numberOfChunks; k = nextChunk++) scanChunk(chunks[k]);
+        };
+        vector<thread> workers;
+        for(long i = 1; i < numberOfThreads && i < numberOfChunks; i++) workers.push_back(thread(worker));
+        worker();
+        for(unsigned int i = 0; i < workers.size(); i++) workers[i].join();
+    }
+    if(statistics) statistics->scanTime = Statistics::elapsed(start);
+
     int section = 0;
     int locationCounter = 0;
-    char *line = readLine();
+    long lastChunk = 0;
+    for(; lastChunk < numberOfChunks; lastChunk++){
+        mergeChunk(chunks[lastChunk], section, locationCounter);
+        if(chunks[lastChunk].endOfProgram) break;
+    }
+    if(lastChunk == numberOfChunks) lastChunk--;
+    symbolTable->assignSymbolNumbers();
+
+    unsigned int numberOfStatements = 0;
+    for(long i = 0; i <= lastChunk; i++) numberOfStatements += chunks[i].statements.size();
+    statements.reserve(numberOfStatements);
+    for(long i = 0; i <= lastChunk; i++){
+        Chunk &chunk = chunks[i];
+        for(unsigned int j = 0; j < chunk.statements.size(); j++){
+            Statement statement = chunk.statements[j];
+            const Segment &segment = chunk.segments[statement.section];
+            statement.section = segment.section;
+            statement.locationCounter += segment.base;
+            statements.push_back(statement);
+        }
+    }
+
+    if(statistics){
+        statistics->firstPassTime = Statistics::elapsed(start);
+        statistics->mergeTime = statistics->firstPassTime - statistics->scanTime;
+        statistics->statements = statements.size();
+        for(long i = 0; i < numberOfChunks; i++){
+            statistics->lines += chunks[i].lines;
+            statistics->tokens += chunks[i].tokens;
+        }
+    }
+}
+
+/*
+ * Scans lines of one chunk. Since location counter
+ * where chunk starts isn't known yet, it's counted
+ * from the start of the current segment, and symbols
+ * are only recorded, to be put into symbol table
+ * by mergeChunk.
+ */
+void Assembly::scanChunk(Chunk& chunk){
+
+    Segment start = {Segment::START, 0, 0, 0, 0, 0};
+    chunk.segments.push_back(start);
+    chunk.endOfProgram = false;
+    chunk.lines = 0;
+    chunk.tokens = 0;
+
+    int segment = 0;
+    int locationCounter = 0;
+    long position = chunk.begin;
+    const char *line;
+    int length;
     bool firstInLine = true;
 
-    while(line && !endOfProgram){
+    try{
+    while(!chunk.endOfProgram && inputFile.readLine(position, chunk.end, line, length)){
 
-        StringTokenizer *st = new StringTokenizer(line);
+        StringTokenizer st(line, length);
         bool endOfLine = false;
         firstInLine = true;
+        chunk.lines++;
 
         while(!endOfLine){
 
-            char *token = st->getNextToken();
-            if(token == nullptr) break;
-            if(st->wasLastTokenLabel()){
+            Token token = st.getNextToken();
+            if(!token) break;
+            if(token.label){
                 if(!firstInLine) throw Error(4);
-                if(symbolTable->findSymbol(token) == nullptr){
-                    symbolTable->addSymbol(token, section, locationCounter, 'l');
-                    firstInLine = false;
-                    continue;
-                }
-                else throw Error(5);
+                SymbolEvent event = {token.start, token.length, 'l', segment, locationCounter};
+                chunk.events.push_back(event);
+                firstInLine = false;
+                continue;
             }
 
-            int type = determineTypeOfToken(token);
+            int mnemonicNo;
+            int type = determineTypeOfToken(token, mnemonicNo);
+
+            Statement statement;
+            statement.type = type;
+            statement.mnemonicNo = mnemonicNo;
+            statement.section = segment;
+            statement.locationCounter = locationCounter;
+            statement.token = token.start;
+            statement.tokenLength = token.length;
+            statement.operands = st.getRestOfLine(statement.operandsLength);
+            if(type != 0) chunk.statements.push_back(statement);
+
             switch(type){
 
             case 1:
@@ -252,68 +690,76 @@ void Assembly::firstPass(){
                 break;
             case 2:
                 while(true){
-                    char *symbol = st->getNextToken();
+                    Token symbol = st.getNextToken();
                     if(symbol){
-                        if(symbolTable->findSymbol(symbol) == nullptr) symbolTable->addSymbol(symbol, 0, 0, 'g');
-                        else throw Error(5);
+                        SymbolEvent event = {symbol.start, symbol.length, 'g', segment, 0};
+                        chunk.events.push_back(event);
                     }
                     else break;
                 }
                 endOfLine = true;
                 break;
             case 3:
-                while(st->getNextToken()) locationCounter += 1;
+                while(st.getNextToken()) locationCounter += 1;
                 endOfLine = true;
                 break;
             case 4:
-                while(st->getNextToken()) locationCounter += 2;
+                while(st.getNextToken()) locationCounter += 2;
                 endOfLine = true;
                 break;
             case 5:
                 {
-                    int numOfArgs = st->calculateNumberOfArguments();
+                    int numOfArgs = st.calculateNumberOfArguments();
                     locationCounter += 4 * (numOfArgs + 1);
+                    /* at most two relocations for each symbol operand */
+                    chunk.segments.back().relocations += 2 * (numOfArgs + 1);
                     endOfLine = true;
                     break;
                 }
 
             case 6:
                 {
-                    char *x = st->getNextToken();
-                    int arg = atoi(x);
-                    int modulo = locationCounter % arg;
-                    if( modulo != 0) locationCounter += arg - modulo;
-                    delete x;
+                    /* aligned counter depends on where segment starts */
+                    Token x = st.getNextToken();
+                    Segment aligned = {Segment::ALIGN, (int)x.parseNumber(0), 0, 0, 0, 0};
+                    chunk.segments.back().length = locationCounter;
+                    chunk.segments.push_back(aligned);
+                    segment++;
+                    locationCounter = 0;
                     endOfLine = true;
                     break;
                 }
             case 7:
                 {
-                    char *y = st->getNextToken();
-                    if(st->getNextToken()) throw Error(12);
-                    int arg = atoi(y);
+                    Token y = st.getNextToken();
+                    if(st.getNextToken()) throw Error(12);
+                    int arg = y.parseNumber(0);
                     locationCounter += arg;
-                    delete y;
                     endOfLine = true;
                     break;
                 }
             case 8:
-                endOfProgram = true;
+                chunk.endOfProgram = true;
                 endOfLine = true;
                 break;
             case 9:
-                if(symbolTable->findSymbol(token) == nullptr){
-                    symbolTable->addSection(token);
-                    token = nullptr;
+                {
+                    Segment newSection = {Segment::SECTION, 0, 0, 0, 0, 0};
+                    chunk.segments.back().length = locationCounter;
+                    chunk.segments.push_back(newSection);
+                    segment++;
                     locationCounter = 0;
-                    section = symbolTable->getLastSectionID();
+                    SymbolEvent event = {token.start, token.length, 's', segment, 0};
+                    chunk.events.push_back(event);
                     endOfLine = true;
                     break;
-                } else throw Error(5);
-
+                }
             case 10:
                 locationCounter += 4;
-                if(token[0] == 'l' && token[1] == 'd' && token[2] == 'c') locationCounter += 4;
+                /* ldch, ldcl and ldc */
+                if(mnemonicNo / NUMBER_OF_CONDITIONS >= 18) locationCounter += 4;
+                /* ldc with a symbol has high and low relocation */
+                if(mnemonicNo / NUMBER_OF_CONDITIONS == 20) chunk.segments.back().relocations += 2;
                 endOfLine = true;
                 break;
             default:
@@ -321,648 +767,764 @@ void Assembly::firstPass(){
                 endOfLine = true;
                 break;
             }
-            delete token;
             firstInLine = false;
         }
+        chunk.tokens += st.getNumberOfTokens();
 
-        delete st;
-        line = readLine();
     }
-    if(inputFileStream.is_open()) inputFileStream.close();
+    }catch(...){
+        chunk.error = current_exception();
+        chunk.eventsBeforeError = chunk.events.size();
+    }
+    chunk.segments.back().length = locationCounter;
 }
 
 /*
- * This method converts decimal number
- * to hexadecimal version.
+ * Puts scanned chunk after the previous ones:
+ * finds where its segments start and which
+ * sections they belong to and adds its symbols
+ * to symbol table. Section and location counter
+ * are those at the end of previous chunk and
+ * are updated to the end of this one.
  */
-string Assembly::convertDecimalToHex(unsigned long long decimal, int b){
+void Assembly::mergeChunk(Chunk& chunk, int& section, int& locationCounter){
+
+    unsigned int numberOfEvents = chunk.error ? chunk.eventsBeforeError : chunk.events.size();
+    unsigned int event = 0;
+
+    for(unsigned int i = 0; i < chunk.segments.size(); i++){
+
+        Segment &segment = chunk.segments[i];
+        if(segment.kind == Segment::SECTION) locationCounter = 0;
+        else if(segment.kind == Segment::ALIGN){
+            int modulo = locationCounter % segment.alignment;
+            if(modulo != 0) locationCounter += segment.alignment - modulo;
+        }
 
-    string result = "";
-    for(int i = 0; i < 2 * b; i++){
-        unsigned long long tmp = decimal & 15;
-        tmp += tmp >= 10 ? 55 : 48;
-        result = (char)tmp + result;
-        decimal >>= 4;
+        for(; event < numberOfEvents && chunk.events[event].segment <= (int)i; event++){
+            const SymbolEvent &e = chunk.events[event];
+            if(symbolTable->findSymbol(e.name, e.length) != nullptr) throw Error(5);
+            if(e.type == 's'){
+                symbolTable->addSection(e.name, e.length);
+                section = symbolTable->getLastSectionID();
+                relocationHints.resize(section + 1, 0);
+            }
+            else if(e.type == 'l') symbolTable->addSymbol(e.name, e.length, section, locationCounter + e.offset, 'l');
+            else symbolTable->addSymbol(e.name, e.length, 0, 0, 'g');
+        }
+
+        segment.base = locationCounter;
+        segment.section = section;
+        locationCounter += segment.length;
+        if(section > 0) relocationHints[section] += segment.relocations;
     }
-    return result;
+
+    if(chunk.error) rethrow_exception(chunk.error);
 }
 
+/*
+ * Encoding of every instruction, in the same
+ * order as instructions array. Condition takes
+ * the top three bits of every instruction.
+ */
+const InstructionEncoding Assembly::encodings[] = {
+    /* int */
+    {0, 7, {{OperandEncoding::INTERRUPT, 20}}},
+    /* add */
+    {1 << 28 | 1 << 24, 17, {{OperandEncoding::REGISTER, 19, 1 << 19},
+        {OperandEncoding::REGISTER_OR_CONSTANT, 13, 1 << 19, 0, 1 << 18}}},
+    /* sub */
+    {1 << 28 | 2 << 24, 17, {{OperandEncoding::REGISTER, 19, 1 << 19},
+        {OperandEncoding::REGISTER_OR_CONSTANT, 13, 1 << 19, 0, 1 << 18}}},
+    /* mul */
+    {1 << 28 | 3 << 24, 17, {{OperandEncoding::REGISTER, 19, 0xF0000},
+        {OperandEncoding::REGISTER_OR_CONSTANT, 13, 0xF0000, 0, 1 << 18}}},
+    /* div */
+    {1 << 28 | 4 << 24, 17, {{OperandEncoding::REGISTER, 19, 0xF0000},
+        {OperandEncoding::REGISTER_OR_CONSTANT, 13, 0xF0000, 0, 1 << 18}}},
+    /* cmp */
+    {1 << 28 | 5 << 24, 17, {{OperandEncoding::REGISTER, 19, 0xF0000},
+        {OperandEncoding::REGISTER_OR_CONSTANT, 13, 0xF0000, 0, 1 << 18}}},
+    /* and */
+    {1 << 28 | 6 << 24, 17, {{OperandEncoding::REGISTER, 19, 0xB0000},
+        {OperandEncoding::REGISTER, 14, 0xB0000}}},
+    /* or */
+    {1 << 28 | 7 << 24, 17, {{OperandEncoding::REGISTER, 19, 0xB0000},
+        {OperandEncoding::REGISTER, 14, 0xB0000}}},
+    /* not */
+    {1 << 28 | 8 << 24, 17, {{OperandEncoding::REGISTER, 19, 0xB0000},
+        {OperandEncoding::REGISTER, 14, 0xB0000}}},
+    /* test */
+    {1 << 28 | 9 << 24, 17, {{OperandEncoding::REGISTER, 19, 0xB0000},
+        {OperandEncoding::REGISTER, 14, 0xB0000}}},
+    /* ldr */
+    {10 << 24 | 1 << 10, 0, {{OperandEncoding::REGISTER, 14},
+        {OperandEncoding::REGISTER_OR_LABEL, 19, 1 << 19, 0, 16 << 19, 1023},
+        {OperandEncoding::ADDRESSING_MODE, 11},
+        {OperandEncoding::CONSTANT, 0}}},
+    /* str */
+    {10 << 24, 0, {{OperandEncoding::REGISTER, 14},
+        {OperandEncoding::REGISTER_OR_LABEL, 19, 1 << 19, 0, 16 << 19, 1023},
+        {OperandEncoding::ADDRESSING_MODE, 11},
+        {OperandEncoding::CONSTANT, 0}}},
+    /* call */
+    {12 << 24, 15, {{OperandEncoding::REGISTER_OR_SYMBOL, 19, 0, 0, 16 << 19, 524287},
+        {OperandEncoding::CONSTANT, 0}}},
+    /* in */
+    {13 << 24 | 1 << 15, 15, {{OperandEncoding::REGISTER, 20},
+        {OperandEncoding::REGISTER, 16}}},
+    /* out */
+    {13 << 24, 15, {{OperandEncoding::REGISTER, 20},
+        {OperandEncoding::REGISTER, 16}}},
+    /* mov */
+    {1 << 28 | 14 << 24, 15, {{OperandEncoding::REGISTER, 19},
+        {OperandEncoding::REGISTER_OR_CONSTANT, 14, 0, 9, 0}}},
+    /* shr */
+    {1 << 28 | 14 << 24, 15, {{OperandEncoding::REGISTER, 19},
+        {OperandEncoding::REGISTER, 14},
+        {OperandEncoding::CONSTANT, 9}}},
+    /* shl */
+    {1 << 28 | 14 << 24 | 1 << 8, 15, {{OperandEncoding::REGISTER, 19},
+        {OperandEncoding::REGISTER, 14},
+        {OperandEncoding::CONSTANT, 9}}},
+    /* ldch */
+    {15 << 24 | 1 << 19, 15, {{OperandEncoding::REGISTER, 20},
+        {OperandEncoding::CONSTANT, 0}}},
+    /* ldcl */
+    {15 << 24, 15, {{OperandEncoding::REGISTER, 20},
+        {OperandEncoding::CONSTANT, 0}}},
+    /* ldc */
+    {15 << 24, 15, {{OperandEncoding::REGISTER, 20},
+        {OperandEncoding::CONSTANT_OR_SYMBOL, 0}}}
+};
+
 /* This method creates machine code for
- * given instruction.
+ * instruction with given index in mnemonics
+ * array, as described in encodings table.
+ * Every operand is classified once and values
+ * are added at their bit positions, so out of
+ * range constants spill into higher fields just
+ * as they always did. ldc gives two words, high
+ * half of constant first. How the result can be
+ * reused for the same operands is left in cached.
  */
-unsigned long long Assembly::createMachineCode(char* mnemonic, StringTokenizer *st, RelocationTable *rt, int pc){
+unsigned long long Assembly::createMachineCode(int instructionNo, StringTokenizer *st, RelocationTable *rt, int pc, CachedEncoding& cached){
 
-    int instructionNo = 0;
-    for(int i = 0; i < NUMBER_OF_MNEMONICS; i++)
-        if(strcmp(mnemonic, mnemonics[i]) == 0){
-            instructionNo = i;
-            break;
-        }
+    if(instructionNo / NUMBER_OF_CONDITIONS >= NUMBER_OF_INSTRUCTIONS) throw Error(19);
+    const InstructionEncoding &encoding = encodings[instructionNo / NUMBER_OF_CONDITIONS];
 
-    int condCode = instructionNo % 7;
+    unsigned long long condCode = instructionNo % NUMBER_OF_CONDITIONS;
     if(condCode == 6) condCode = 7;
-    unsigned long long machineCode = condCode;
-    switch(instructionNo / 7){
-    case 0:
-        {   /* int instruction */
-            machineCode <<= 9;
-            char *interrupt = st->getNextToken();
-            if(interrupt == nullptr) throw Error(6);
-            int intNum = atoi(interrupt);
+    unsigned long long machineCode = condCode << 29 | encoding.opcode;
+    int firstRegister = -1;
+    cached.cacheable = true;
+    cached.symbol = nullptr;
+    cached.displacementMask = 0;
+
+    for(int i = 0; i < InstructionEncoding::MAX_OPERANDS; i++){
+
+        const OperandEncoding &operand = encoding.operands[i];
+        if(operand.kind == OperandEncoding::NONE) break;
+
+        Token t = st->getNextToken();
+
+        if(operand.kind == OperandEncoding::INTERRUPT){
+            if(!t) throw Error(6);
+            int intNum = t.parseNumber(0);
             if(intNum < 0 || intNum > 15) throw Error(8);
-            machineCode += intNum;
-            delete [] interrupt;
-            if(st->getNextToken()) throw Error(7);
-            return machineCode << 20;
-        }
-    case 1:
-    case 2:
-        {   /* add and sub instruction */
-            machineCode <<= 1;
-            machineCode += 1;
-            machineCode <<= 4;
-            machineCode += instructionNo / 7;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            machineCode <<= 5;
-            int x = atoi(t + 1);
-            if(x == 19) throw Error(16);
-            machineCode += x;
-            delete [] t;
-            machineCode <<= 1;
-            t = st->getNextToken();
-            int type = determineTypeOfToken(t);
-            if(type == REGISTER){
-                machineCode <<= 5;
-                x = atoi(t + 1);
-                if(x == 19) throw Error(16);
-                machineCode += x;
-                machineCode <<= 13;
-            }
-            else {
-                if(type == CONSTANT){
-                    machineCode += 1;
-                    machineCode <<= 18;
-                    machineCode += atoi(t + 1);
-                }else throw Error(15);
-            }
-            delete [] t;
-            if(st->getNextToken()) throw Error(17);
-            return machineCode;
-        }
-    case 3:
-    case 4:
-    case 5:
-        {   /* mul, div and cmp instruction */
-            machineCode <<= 1;
-            machineCode += 1;
-            machineCode <<= 4;
-            machineCode += instructionNo / 7;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            machineCode <<= 5;
-            int x = atoi(t + 1);
-            if(x > 15) throw Error(16);
-            machineCode += x;
-            delete [] t;
-            machineCode <<= 1;
-            t = st->getNextToken();
-            int type = determineTypeOfToken(t);
-            if(type == REGISTER){
-                machineCode <<= 5;
-                x = atoi(t + 1);
-                if(x > 15) throw Error(16);
-                machineCode += x;
-                machineCode <<= 13;
-            }
-            else {
-                if(type == CONSTANT){
-                    machineCode += 1;
-                    machineCode <<= 18;
-                    machineCode += atoi(t + 1);
-                }else throw Error(15);
-            }
-            delete [] t;
-            if(st->getNextToken()) throw Error(17);
-            return machineCode;
+            machineCode += (unsigned long long)intNum << operand.position;
+            continue;
         }
 
-    case 6:
-    case 7:
-    case 8:
-    case 9:
-        {   /* and, or, not and test instruction */
-            machineCode <<= 1;
-            machineCode += 1;
-            machineCode <<= 4;
-            machineCode += instructionNo / 7;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            machineCode <<= 5;
-            int x = atoi(t + 1);
-            if(x == 16 || x == 17 || x == 19) throw Error(16);
-            machineCode += x;
-            delete [] t;
-            t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            machineCode <<= 5;
-            x = atoi(t + 1);
-            if(x == 16 || x == 17 || x == 19) throw Error(16);
-            machineCode += x;
-            delete [] t;
-            if(st->getNextToken()) throw Error(17);
-            machineCode <<= 14;
-            return machineCode;
-        }
-    case 10:
-    case 11: /* ldr and str instructions */
-        {
-            machineCode <<= 5;
-            machineCode += 10;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            machineCode <<= 5;
-            int x = atoi(t + 1);
-            delete [] t;
-            t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER && !st->wasLastTokenLabel()) throw Error(15);
-            if(st->wasLastTokenLabel()){
-                machineCode += 16;
-                machineCode <<= 5;
-                machineCode += x;
-                machineCode <<= 4;
-                if(instructionNo / 7 == 10) machineCode += 1;
-                machineCode <<= 10;
-                if(st->getNextToken()) throw Error(15);
-                Symbol *s = symbolTable->findSymbol(t);
-                x = s->getOffset() - pc;
-                delete [] t;
-                x = x & 1023;
-                machineCode += x;
-                return machineCode;
-            }else{
-                int y = atoi(t + 1);
-                if(y == 19) throw Error(16);
-                delete [] t;
-                machineCode += y;
-                machineCode <<= 5;
-                machineCode += x;
-                t = st->getNextToken();
-                if(determineTypeOfToken(t) != CONSTANT) throw Error(15);
-                y = atoi(t + 1);
-                if(y < 2 || y > 5) throw Error(15);
-                if(x == 16 && y != 0) throw Error(15);
-                machineCode <<= 3;
-                machineCode += y;
-                machineCode <<= 1;
-                if(instructionNo / 7 == 10) machineCode += 1;
-                machineCode <<= 10;
-                delete [] t;
-                t = st->getNextToken();
-                if(determineTypeOfToken(t) != CONSTANT) throw Error(15);
-                machineCode += atoi(t + 1);
-                delete [] t;
-                return machineCode;
-            }
+        int type = determineTypeOfToken(t);
+        Symbol *symbol = nullptr;
+        bool alternative = false;
+
+        switch(operand.kind){
+        case OperandEncoding::REGISTER:
+            if(type != REGISTER) throw Error(15);
+            break;
+        case OperandEncoding::CONSTANT:
+        case OperandEncoding::ADDRESSING_MODE:
+            if(type != CONSTANT) throw Error(15);
+            break;
+        case OperandEncoding::REGISTER_OR_CONSTANT:
+            if(type != REGISTER && type != CONSTANT) throw Error(15);
+            alternative = type == CONSTANT;
+            break;
+        case OperandEncoding::REGISTER_OR_LABEL:
+            if(type != REGISTER && !t.label) throw Error(15);
+            alternative = t.label;
+            break;
+        case OperandEncoding::REGISTER_OR_SYMBOL:
+            symbol = symbolTable->findSymbol(t.start, t.length);
+            if(type != REGISTER && symbol == nullptr) throw Error(15);
+            alternative = symbol != nullptr;
+            break;
+        case OperandEncoding::CONSTANT_OR_SYMBOL:
+            if(type != CONSTANT) symbol = symbolTable->findSymbol(t.start, t.length);
+            if(type != CONSTANT && symbol == nullptr) throw Error(15);
+            alternative = symbol != nullptr;
+            break;
         }
-    case 12: /* call instruction */
-        {
-            machineCode <<= 5;
-            machineCode += 12;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER && symbolTable->findSymbol(t) == nullptr) throw Error(15);
-            machineCode <<= 5;
-            if(symbolTable->findSymbol(t) != nullptr){
-                if(st->getNextToken()) throw Error(15);
-                machineCode += 16;
-                machineCode <<= 19;
-                Symbol *s = symbolTable->findSymbol(t);
-                if(s == nullptr) throw Error(17);
-                int x = s->getOffset() - pc;
-                x = x & 524287;
-                machineCode += x;
+
+        if(operand.kind == OperandEncoding::CONSTANT_OR_SYMBOL){
+            /* constant is split in two halves, symbol is relocated */
+            long x = 0;
+            if(!alternative) x = t.parseNumber(1);
+            else if(symbol->getVisibility() == 'l'){
+                x = symbol->getOffset();
+                rt->insertNewEntry(pc - 2, RelocationTable::R_16_high, symbol->getSection());
+                rt->insertNewEntry(pc + 2, RelocationTable::R_16_low, symbol->getSection());
             }else{
-                int x = atoi(t + 1);
-                machineCode += x;
-                delete [] t;
-                t = st->getNextToken();
-                if(determineTypeOfToken(t) != CONSTANT) throw Error(15);
-                x = atoi(t + 1);
-                delete [] t;
-                machineCode <<= 19;
-                machineCode += x;
-                if(st->getNextToken()) throw Error(15);
+                rt->insertNewEntry(pc - 1, RelocationTable::R_16_high, symbol->getSymbolNo());
+                rt->insertNewEntry(pc + 3, RelocationTable::R_16_low, symbol->getSymbolNo());
             }
-            return machineCode;
-        }
-    case 13:
-    case 14: /* in and out instructions */
-        {
-            machineCode <<= 5;
-            machineCode += 13;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            int x = atoi(t + 1);
-            delete [] t;
-            machineCode <<= 4;
-            machineCode += x;
-            t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            x = atoi(t + 1);
-            delete [] t;
-            machineCode <<= 4;
-            machineCode += x;
-            machineCode <<= 1;
-            if(instructionNo / 7 == 13) machineCode += 1;
-            machineCode <<= 15;
             if(st->getNextToken()) throw Error(15);
-            return machineCode;
+            cached.cacheable = !alternative;
+            unsigned long long high = machineCode + (1 << 19) + ((x >> 16) & 65535);
+            unsigned long long low = machineCode + (x & 65535);
+            cached.machineCode = (high << 32) | low;
+            return cached.machineCode;
         }
-    case 15:
-    case 16:
-    case 17: /* mov, shr, shl instructions */
-        {
-            machineCode <<= 1;
-            machineCode += 1;
-            machineCode <<= 4;
-            machineCode += 14;
-            machineCode <<= 5;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            int x = atoi(t + 1);
-            machineCode += x;
-            machineCode <<= 5;
-            delete [] t;
-            t = st->getNextToken();
-            if(instructionNo / 7 == 15){
-                if(determineTypeOfToken(t) != REGISTER && determineTypeOfToken(t) != CONSTANT) throw Error(15);
-                if(determineTypeOfToken(t) == REGISTER){
-                    machineCode += atoi(t + 1);
-                    delete [] t;
-                    if(st->getNextToken()) throw Error(15);
-                    machineCode <<= 14;
-                    return machineCode;
-                }
-                if(determineTypeOfToken(t) == CONSTANT){
-                    machineCode <<= 5;
-                    machineCode += atoi(t + 1);
-                    delete [] t;
-                    if(st->getNextToken()) throw Error(15);
-                    machineCode <<= 9;
-                    return machineCode;
-                }
+
+        if(operand.kind == OperandEncoding::REGISTER_OR_LABEL || operand.kind == OperandEncoding::REGISTER_OR_SYMBOL){
+            if(alternative){
+                /* pc relative form takes no more operands */
+                if(st->getNextToken()) throw Error(15);
+                if(symbol == nullptr) symbol = symbolTable->findSymbol(t.start, t.length);
+                if(symbol == nullptr) throw Error(18);
+                int x = symbol->getOffset() - pc;
+                cached.symbol = symbol;
+                cached.displacementMask = operand.displacementMask;
+                cached.machineCode = machineCode + operand.alternativeBits;
+                return machineCode + operand.alternativeBits + (x & operand.displacementMask);
             }
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            machineCode += atoi(t + 1);
-            delete [] t;
-            machineCode <<= 5;
-            t = st->getNextToken();
-            if(determineTypeOfToken(t) != CONSTANT) throw Error(15);
-            machineCode += atoi(t + 1);
-            delete [] t;
-            if(st->getNextToken()) throw Error(15);
-            machineCode <<= 1;
-            if(instructionNo / 7 == 17) machineCode += 1;
-            machineCode <<= 8;
-            return machineCode;
         }
-    case 18:
-    case 19: /* ldch and ldcl instructions */
-        {
-            machineCode <<= 5;
-            machineCode += 15;
-            machineCode <<= 4;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            machineCode += atoi(t + 1);
-            delete [] t;
-            machineCode <<= 1;
-            if(instructionNo / 7 == 18) machineCode += 1;
-            machineCode <<= 19;
-            t = st->getNextToken();
-            if(determineTypeOfToken(t) != CONSTANT) throw Error(15);
-            machineCode += atoi(t + 1);
-            delete [] t;
-            if(st->getNextToken()) throw Error(15);
-            return machineCode;
+
+        int x = t.parseNumber(1);
+        if(operand.kind == OperandEncoding::ADDRESSING_MODE){
+            if(x < 2 || x > 5) throw Error(15);
+            if(firstRegister == 16) throw Error(15);
         }
-    case 20:
-        {
-            machineCode <<= 5;
-            machineCode += 15;
-            machineCode <<= 4;
-            char *t = st->getNextToken();
-            if(determineTypeOfToken(t) != REGISTER) throw Error(15);
-            machineCode += atoi(t + 1);
-            delete [] t;
-            machineCode <<= 1;
-            unsigned long long macode = machineCode;
-            machineCode += 1;
-            machineCode <<= 19;
-            macode <<= 19;
-            t = st->getNextToken();
-            if(determineTypeOfToken(t) != CONSTANT && symbolTable->findSymbol(t) == nullptr) throw Error(15);
-            long x = 0;
-            long y = 0;
-            if(determineTypeOfToken(t) == CONSTANT){
-                x = atol(t + 1);
-                y = x >> 16;
-            }
-            else{
-                Symbol *s = symbolTable->findSymbol(t);
-                if(s == nullptr) throw Error(18);
-                if(s->getVisibility() == 'l'){
-                    x = s->getOffset();
-                    y = x >> 16;
-                    rt->insertNewEntry(pc - 2, "R_16_high", s->getSection());
-                    rt->insertNewEntry(pc + 2, "R_16_low", s->getSection());
-                }else{
-                    x = 0;
-                    y = 0;
-                    rt->insertNewEntry(pc - 1, "R_16_high", s->getSymbolNo());
-                    rt->insertNewEntry(pc + 3, "R_16_low", s->getSymbolNo());
-                }
-            }
-            x = x & 65535;
-            machineCode += y & 65535;
-            macode += x;
-            delete [] t;
-            if(st->getNextToken()) throw Error(15);
-            return (machineCode << 32) | macode;
+        if(type == REGISTER){
+            if(operand.forbiddenRegisters >> x & 1) throw Error(16);
+            if(firstRegister < 0) firstRegister = x;
         }
-    default:
-        throw Error(19);
+        if(alternative) machineCode += ((unsigned long long)x << operand.alternativePosition) + operand.alternativeBits;
+        else machineCode += (unsigned long long)x << operand.position;
     }
 
-    return 0;
+    if(encoding.trailingError != 0 && st->getNextToken()) throw Error(encoding.trailingError);
+    cached.machineCode = machineCode;
+    return machineCode;
 }
 
 /*
  * This method does the second pass
  * of the assembly, meaning it creates
  * machine code and reallocation entries.
+ * It doesn't read the input again, but
+ * goes through statements recorded in
+ * the first pass, encoding sections on
+ * separate threads when it can.
  */
 void Assembly::secondPass(){
 
-    inputFileStream.open(inputFileName, fstream::in);
+    if(pipeline && !binaryOutput){
+        runPipeline();
+        return;
+    }
 
-    endOfProgram = false;
-    int section = 0;
-    int locationCounter = 0;
-    string machineCode = "";
-    char *line = readLine();
-    rTables = new RelocationTable*[symbolTable->getLastSectionID()];
-    Symbol *s = nullptr;
+    if(statistics == nullptr){
+        encodeSections();
+        return;
+    }
 
-    while(line && !endOfProgram){
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    encodeSections();
+    statistics->secondPassTime = statistics->encodeTime = Statistics::elapsed(start);
+    for(int i = 0; i < symbolTable->getLastSectionID(); i++){
+        if(rTables[i]) statistics->relocations += rTables[i]->getSize();
+        statistics->sectionBytes += sectionCode[i + 1].getSize();
+    }
+}
 
-        StringTokenizer *st = new StringTokenizer(line);
-        bool endOfLine = false;
+/*
+ * Encodes all statements into machine code and
+ * relocation tables of their sections.
+ */
+void Assembly::encodeSections(){
 
-        while(!endOfLine){
+    int numberOfSections = symbolTable->getLastSectionID();
+    /* code found before the first section goes to buffer 0 and is never written;
+       buffers and tables of an earlier input are reused */
+    if((int)sectionCode.size() < numberOfSections + 1) sectionCode.resize(numberOfSections + 1);
+    for(int i = 0; i <= numberOfSections; i++) sectionCode[i].clear();
+    Symbol *s = symbolTable->getFirst()->getNext();
+    for(int i = 0; i < numberOfSections; i++, s = s->getNext()){
+        if(i < (int)rTables.size()) rTables[i]->reset(s->getName());
+        else rTables.push_back(new RelocationTable(s->getName()));
+    }
+
+    /* last section is written only if it is ended by .end */
+    completeSections = numberOfSections;
+    if((statements.empty() || statements.back().type != END) && numberOfSections > 0) completeSections--;
 
-            char *token = st->getNextToken();
+    vector<unsigned int> sectionStart;
+    bool publicInSection = false;
+    for(unsigned int i = 0; i < statements.size(); i++){
+        if(statements[i].type == SECTION) sectionStart.push_back(i);
+        else if(statements[i].type == PUBLIC && !sectionStart.empty()) publicInSection = true;
+    }
 
-            if(token == nullptr) break;
+    /* .public changes how later statements are encoded, so if it
+       appears inside a section everything is encoded in order */
+    if(sectionStart.empty() || publicInSection){
+        encodeStatements(0, statements.size());
+        if(encodedSections) for(int i = 1; i <= numberOfSections; i++) encodedSections->push(i);
+        return;
+    }
+
+    encodeStatements(0, sectionStart[0]);
+    sectionStart.push_back(statements.size());
+    unsigned int numberOfRanges = sectionStart.size() - 1;
+
+    /* sections that didn't change since the last run are copied from cache */
+    IncrementalCache cache, previousCache;
+    vector<unsigned long long> hashes(numberOfRanges);
+    bool reuse = cacheFileName && previousCache.load(cacheFileName);
+    vector<unsigned int> pending;
+    for(unsigned int k = 0; k < numberOfRanges; k++){
+        if(cacheFileName){
+            hashes[k] = hashStatements(sectionStart[k], sectionStart[k + 1]);
+            if(reuse && restoreSection(previousCache, statements[sectionStart[k]], hashes[k])) continue;
+        }
+        pending.push_back(k);
+    }
 
-            if(st->wasLastTokenLabel()) {
-                    delete token;
-                    token = nullptr;
-                    continue;
+    if(encodedSections){
+        /* sections are handed to output in order as soon as they are done */
+        unsigned int next = 0;
+        for(unsigned int k = 0; k < numberOfRanges; k++){
+            if(next < pending.size() && pending[next] == k){
+                encodeStatements(sectionStart[k], sectionStart[k + 1]);
+                next++;
             }
-            int type = determineTypeOfToken(token);
-            switch(type){
+            const Statement &statement = statements[sectionStart[k]];
+            encodedSections->push(symbolTable->findSymbol(statement.token, statement.tokenLength)->getSymbolNo());
+        }
+    }else if(numberOfThreads < 2 || pending.size() < 2){
+        for(unsigned int i = 0; i < pending.size(); i++) encodeStatements(sectionStart[pending[i]], sectionStart[pending[i] + 1]);
+    }else{
+        vector<exception_ptr> errors(pending.size());
+        atomic<unsigned int> nextRange(0);
 
-            case 1: /* .public */
-                {
-                    char *s = st->getNextToken();
-                    while(s){
-                        Symbol *symbol = symbolTable->findSymbol(s);
-                        if(symbol == nullptr) throw Error(9);
-                        else symbol->setVisibility('g');
-                        s = st->getNextToken();
-                    }
-                    endOfLine = true;
-                    break;
+        auto worker = [&](){
+            for(unsigned int i = nextRange++; i < pending.size(); i = nextRange++){
+                try{
+                    encodeStatements(sectionStart[pending[i]], sectionStart[pending[i] + 1]);
+                }catch(...){
+                    errors[i] = current_exception();
+                }
+            }
+        };
+        vector<thread> workers;
+        for(unsigned int i = 1; i < (unsigned int)numberOfThreads && i < pending.size(); i++) workers.push_back(thread(worker));
+        worker();
+        for(unsigned int i = 0; i < workers.size(); i++) workers[i].join();
+
+        /* report the error that sequential encoding would have hit first */
+        for(unsigned int i = 0; i < pending.size(); i++) if(errors[i]) rethrow_exception(errors[i]);
+    }
+
+    if(cacheFileName){
+        for(unsigned int k = 0; k < numberOfRanges; k++){
+            const Statement &statement = statements[sectionStart[k]];
+            Symbol *s = symbolTable->findSymbol(statement.token, statement.tokenLength);
+            cache.addSection(s->getName(), hashes[k], sectionCode[s->getSymbolNo()], rTables[s->getSymbolNo() - 1]);
+        }
+        cache.save(cacheFileName);
+    }
+}
+
+/*
+ * Second pass and text output as a pipeline of
+ * three stages: this thread encodes sections in
+ * order, a formatter turns every finished section
+ * and, at the end, relocation tables and symbol
+ * table into text, and a writer writes the text
+ * to the file. Stages are connected by bounded
+ * single producer, single consumer queues, and a
+ * fixed set of buffers goes around between the
+ * formatter and the writer. Output is the same as
+ * in sequential mode; if encoding fails, whatever
+ * was written is thrown away.
+ */
+void Assembly::runPipeline(){
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    SpscQueue<int> sections(PIPELINE_QUEUE_SIZE);
+    SpscQueue<OutputBuffer*> filled(PIPELINE_BUFFERS), empty(PIPELINE_BUFFERS);
+    OutputBuffer buffers[PIPELINE_BUFFERS];
+    for(int i = 0; i < PIPELINE_BUFFERS; i++) empty.push(&buffers[i]);
+    bool failed = false;
+    double formatTime = 0, writeTime = 0;
+
+    thread writer([&](){
+        for(OutputBuffer *buffer = filled.pop(); buffer; buffer = filled.pop()){
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            buffer->writeToFile(*output);
+            writeTime += Statistics::elapsed(start);
+            empty.push(buffer);
+        }
+    });
+
+    /* section number 0 ends the sections */
+    thread formatter([&](){
+        for(int section = sections.pop(); section > 0; section = sections.pop()){
+            if(section > completeSections) continue;
+            OutputBuffer *buffer = empty.pop();
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            formatMachineCode(sectionCode[section], rTables[section - 1]->getSectionName(), *buffer);
+            formatTime += Statistics::elapsed(start);
+            filled.push(buffer);
+        }
+        if(!failed){
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for(int i = 0; i <= symbolTable->getLastSectionID(); i++){
+                OutputBuffer *buffer = empty.pop();
+                if(i < symbolTable->getLastSectionID()) rTables[i]->writeTableToFile(*buffer);
+                else symbolTable->saveToFile(*buffer);
+                filled.push(buffer);
+            }
+            formatTime += Statistics::elapsed(start);
+        }
+        filled.push(nullptr);
+    });
+
+    exception_ptr error;
+    encodedSections = &sections;
+    try{
+        encodeSections();
+    }catch(...){
+        error = current_exception();
+        failed = true;
+    }
+    encodedSections = nullptr;
+    double encodeTime = Statistics::elapsed(start);
+    sections.push(0);
+    formatter.join();
+    writer.join();
+
+    if(error){
+        /* what went to standard output can't be taken back */
+        if(output == &outputFileStream){
+            outputFileStream.close();
+            outputFileStream.open(outputFileName, fstream::out | fstream::trunc | fstream::binary);
+        }
+        rethrow_exception(error);
+    }
+    outputWritten = true;
+
+    if(statistics){
+        statistics->secondPassTime = statistics->encodeTime = encodeTime;
+        statistics->outputTime = formatTime + writeTime;
+        statistics->writeTime = writeTime;
+        for(int i = 0; i < symbolTable->getLastSectionID(); i++){
+            if(rTables[i]) statistics->relocations += rTables[i]->getSize();
+            statistics->sectionBytes += sectionCode[i + 1].getSize();
+        }
+    }
+}
+
+/*
+ * Hash of everything in statements [first, last)
+ * that their encoding depends on: their text and
+ * location counters, and section, offset,
+ * visibility and number of every symbol their
+ * operands name. Symbols elsewhere can move
+ * without changing the hash.
+ */
+unsigned long long Assembly::hashStatements(unsigned int first, unsigned int last){
+
+    unsigned long long h = 14695981039346656037ull;
+    for(unsigned int i = first; i < last; i++){
+        const Statement &statement = statements[i];
+        h = IncrementalCache::hash(statement.type, h);
+        h = IncrementalCache::hash(statement.mnemonicNo, h);
+        /* section directive carries where the previous section ended */
+        if(statement.type != SECTION) h = IncrementalCache::hash(statement.locationCounter, h);
+        h = IncrementalCache::hash(statement.tokenLength, h);
+        h = IncrementalCache::hash(statement.token, statement.tokenLength, h);
+        h = IncrementalCache::hash(statement.operandsLength, h);
+        h = IncrementalCache::hash(statement.operands, statement.operandsLength, h);
+        StringTokenizer st(statement.operands, statement.operandsLength);
+        for(Token t = st.getNextToken(); t; t = st.getNextToken()){
+            Symbol *s = symbolTable->findSymbol(t.start, t.length);
+            if(s == nullptr) continue;
+            h = IncrementalCache::hash(s->getSection(), h);
+            h = IncrementalCache::hash(s->getOffset(), h);
+            h = IncrementalCache::hash(s->getVisibility(), h);
+            h = IncrementalCache::hash(s->getSymbolNo(), h);
+        }
+    }
+    return h;
+}
+
+/*
+ * Fills section started by given statement from
+ * cache, if cache has it with the same hash.
+ */
+bool Assembly::restoreSection(IncrementalCache& cache, const Statement& statement, unsigned long long hash){
+
+    Symbol *s = symbolTable->findSymbol(statement.token, statement.tokenLength);
+    int i = cache.findSection(s->getName(), hash);
+    if(i < 0) return false;
+    int section = s->getSymbolNo();
+    cache.restoreSection(i, sectionCode[section], rTables[section - 1]);
+    if(statistics) statistics->reusedSections++;
+    return true;
+}
+
+/*
+ * This method encodes statements in range [first, last)
+ * into machine code and relocation entries of their
+ * sections. Ranges that start with a section directive
+ * don't depend on each other and can be encoded on
+ * different threads. Every call has its own cache of
+ * encoded instructions, so threads don't share one.
+ */
+void Assembly::encodeStatements(unsigned int first, unsigned int last){
+
+    int section = 0;
+    int locationCounter = 0;
+    MachineCode *machineCode = &sectionCode[0];
+    long tokens = 0;
+    EncodingCache encodingCache;
+
+    for(unsigned int i = first; i < last; i++){
+
+        const Statement &statement = statements[i];
+        StringTokenizer st(statement.operands, statement.operandsLength);
+
+        switch(statement.type){
+
+        case 1: /* .public */
+            {
+                Token s = st.getNextToken();
+                while(s){
+                    Symbol *symbol = symbolTable->findSymbol(s.start, s.length);
+                    if(symbol == nullptr) throw Error(9);
+                    else symbol->setVisibility('g');
+                    s = st.getNextToken();
                 }
-            case 2: /* .extern */
-                endOfLine = true;
                 break;
-            case 3: /* .char */
-                {
-                    char *t = st->getNextToken();
-                    while(t){
-                        if(strlen(t) > 1) throw Error(10);
-                        if((t[0] >= '0' && t[0] <= '9') || (t[0] >= 'a' && t[0] <= 'z') || (t[0] >= 'A' && t[0] <= 'Z')){
-                            locationCounter += 1;
-                            machineCode = machineCode + convertDecimalToHex((unsigned long)t[0], 1);
-                        }else throw Error(11);
-                        t = st->getNextToken();
-                    }
-                    endOfLine = true;
-                    break;
+            }
+        case 2: /* .extern */
+            break;
+        case 3: /* .char */
+            {
+                Token t = st.getNextToken();
+                while(t){
+                    if(t.length > 1) throw Error(10);
+                    if((t[0] >= '0' && t[0] <= '9') || (t[0] >= 'a' && t[0] <= 'z') || (t[0] >= 'A' && t[0] <= 'Z')){
+                        locationCounter += 1;
+                        machineCode->appendByte(t[0]);
+                    }else throw Error(11);
+                    t = st.getNextToken();
                 }
-            case 4: /* .word */
-                {
-                    char *t = st->getNextToken();
-                    while(t){
-                        int arg = atoi(t);
-                        locationCounter += 2;
-                        ostringstream oss;
-                        oss << arg;
-                        string s = oss.str();
-                        if(s.length() == 1) s = "000" + s;
-                        else{
-                            if(s.length() == 2) s = "00" + s;
-                            else{
-                                if(s.length() == 3) s = "0" + s;
-                            }
-                        }
-                        machineCode = machineCode + s[2] + s[3] + s[0] + s[1];
-                        t = st->getNextToken();
-                    }
-                    endOfLine = true;
-                    break;
+                break;
+            }
+        case 4: /* .word */
+            {
+                Token t = st.getNextToken();
+                while(t){
+                    long arg = (int)t.parseNumber(0);
+                    locationCounter += 2;
+                    /* decimal digits of argument are stored as packed BCD,
+                       lower two digits first; only first four digits count */
+                    if(arg < 0) arg = -arg;
+                    while(arg > 9999) arg /= 10;
+                    machineCode->appendByte((arg / 10 % 10) << 4 | arg % 10);
+                    machineCode->appendByte((arg / 1000 % 10) << 4 | arg / 100 % 10);
+                    t = st.getNextToken();
                 }
-            case 5: /* .long */
-                {
-                    char *t = st->getNextToken();
-                    while(t){
-                        string code = "";
-                        if(t == nullptr) throw Error(15);
-                        if(determineTypeOfToken(t) != CONSTANT && symbolTable->findSymbol(t) == nullptr) throw Error(18);
-                        if(determineTypeOfToken(t) == CONSTANT){
-                            long x = atol(t + 1);
-                            code += convertDecimalToHex(x, 4);
-                            delete [] t;
-                            t = st->getNextToken();
-                            if(t != nullptr && (t[0] == '+' || t[0] == '-')) throw Error(21);
-                        }else{
-                            Symbol *s = symbolTable->findSymbol(t);
-                            delete [] t;
-                            t = st->getNextToken();
-                            if(t != nullptr && (t[0] == '-' || t[0] == '+')){
-                                bool addition = t[0] == '+' ? true : false;
-                                delete [] t;
-                                t = st->getNextToken();
-                                if(t == nullptr || symbolTable->findSymbol(t) == nullptr) throw Error(18);
-                                Symbol *s2 = symbolTable->findSymbol(t);
-                                delete [] t;
-                                if(addition){
-                                    if(s->getVisibility() == 'l' && s2->getVisibility() == 'l'){
-                                        code += convertDecimalToHex(s->getOffset() + s2->getOffset(), 4);
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSection());
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s2->getSection());
-                                    }
-                                    if(s->getVisibility() == 'g' && s2->getVisibility() == 'g'){
-                                        code += "00000000";
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSymbolNo());
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s2->getSymbolNo());
-                                    }
-                                    if(s->getVisibility() == 'l' && s2->getVisibility() == 'g'){
-                                        code += convertDecimalToHex(s->getOffset(), 4);
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSection());
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s2->getSymbolNo());
-                                    }
-                                    if(s->getVisibility() == 'g' && s2->getVisibility() == 'l'){
-                                        code += convertDecimalToHex(s2->getOffset(), 4);
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s2->getSection());
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSymbolNo());
-                                    }
-                                }else{
-                                    if(s->getVisibility() == 'l' && s2->getVisibility() == 'l'){
-                                        code += convertDecimalToHex(s->getOffset() - s2->getOffset(), 4);
-                                    }
-                                    if(s->getVisibility() == 'g' && s2->getVisibility() == 'g'){
-                                        code += "00000000";
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSymbolNo());
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32_negative", s2->getSymbolNo());
-                                    }
-                                    if(s->getVisibility() == 'l' && s2->getVisibility() == 'g'){
-                                        code += convertDecimalToHex(s->getOffset(), 4);
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSection());
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32_negative", s2->getSymbolNo());
-                                    }
-                                    if(s->getVisibility() == 'g' && s2->getVisibility() == 'l'){
-                                        code += convertDecimalToHex(-s2->getOffset(), 4);
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32_negative", s2->getSection());
-                                        rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSymbolNo());
-                                    }
+                break;
+            }
+        case 5: /* .long */
+            {
+                Token t = st.getNextToken();
+                while(t){
+                    long code = 0;
+                    if(!t) throw Error(15);
+                    if(determineTypeOfToken(t) != CONSTANT && symbolTable->findSymbol(t.start, t.length) == nullptr) throw Error(18);
+                    if(determineTypeOfToken(t) == CONSTANT){
+                        long x = t.parseNumber(1);
+                        code = x;
+                        t = st.getNextToken();
+                        if(t && (t[0] == '+' || t[0] == '-')) throw Error(21);
+                    }else{
+                        Symbol *s = symbolTable->findSymbol(t.start, t.length);
+                        t = st.getNextToken();
+                        if(t && (t[0] == '-' || t[0] == '+')){
+                            bool addition = t[0] == '+' ? true : false;
+                            t = st.getNextToken();
+                            if(!t || symbolTable->findSymbol(t.start, t.length) == nullptr) throw Error(18);
+                            Symbol *s2 = symbolTable->findSymbol(t.start, t.length);
+                            if(addition){
+                                if(s->getVisibility() == 'l' && s2->getVisibility() == 'l'){
+                                    code = s->getOffset() + s2->getOffset();
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSection());
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s2->getSection());
+                                }
+                                if(s->getVisibility() == 'g' && s2->getVisibility() == 'g'){
+                                    code = 0;
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSymbolNo());
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s2->getSymbolNo());
+                                }
+                                if(s->getVisibility() == 'l' && s2->getVisibility() == 'g'){
+                                    code = s->getOffset();
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSection());
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s2->getSymbolNo());
+                                }
+                                if(s->getVisibility() == 'g' && s2->getVisibility() == 'l'){
+                                    code = s2->getOffset();
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s2->getSection());
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSymbolNo());
                                 }
                             }else{
-                                long x;
-                                if(s->getVisibility() == 'l'){
-                                    x = s->getOffset();
-                                    rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSection());
-                                    code += convertDecimalToHex(x, 4);
-                                }else{
-                                    rTables[section - 1]->insertNewEntry(locationCounter, "R_32", s->getSymbolNo());
-                                    code += "00000000";
+                                if(s->getVisibility() == 'l' && s2->getVisibility() == 'l'){
+                                    code = s->getOffset() - s2->getOffset();
+                                }
+                                if(s->getVisibility() == 'g' && s2->getVisibility() == 'g'){
+                                    code = 0;
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSymbolNo());
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32_negative, s2->getSymbolNo());
+                                }
+                                if(s->getVisibility() == 'l' && s2->getVisibility() == 'g'){
+                                    code = s->getOffset();
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSection());
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32_negative, s2->getSymbolNo());
+                                }
+                                if(s->getVisibility() == 'g' && s2->getVisibility() == 'l'){
+                                    code = -s2->getOffset();
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32_negative, s2->getSection());
+                                    rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSymbolNo());
                                 }
                             }
-                            t = st->getNextToken();
+                        }else{
+                            long x;
+                            if(s->getVisibility() == 'l'){
+                                x = s->getOffset();
+                                rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSection());
+                                code = x;
+                            }else{
+                                rTables[section - 1]->insertNewEntry(locationCounter, RelocationTable::R_32, s->getSymbolNo());
+                                code = 0;
+                            }
                         }
-                        machineCode += code[6];
-                        machineCode += code[7];
-                        machineCode += code[4];
-                        machineCode += code[5];
-                        machineCode += code[2];
-                        machineCode += code[3];
-                        machineCode += code[0];
-                        machineCode += code[1];
-                        locationCounter += 4;
-
+                        t = st.getNextToken();
                     }
-                    endOfLine = true;
-                    break;
-                }
-            case 6: /* .align */
-                {
-                    char *x = st->getNextToken();
-                    int arg = atoi(x);
-                    int modulo = locationCounter % arg;
-                    if( modulo != 0){
-                        locationCounter += arg - modulo;
-                        for(int i = 0; i < arg - modulo; i++) machineCode += "00";
-                    }
-                    delete x;
-                    endOfLine = true;
-                    break;
+                    machineCode->appendLittleEndian(code, 4);
+                    locationCounter += 4;
+
                 }
-            case 7: /* .skip */
-                {
-                    char *y = st->getNextToken();
-                    int arg = atoi(y);
-                    locationCounter += arg;
-                    for(int i = 0; i < arg; i++) machineCode += "00";
-                    delete y;
-                    endOfLine = true;
-                    break;
+                break;
+            }
+        case 6: /* .align */
+            {
+                Token x = st.getNextToken();
+                int arg = x.parseNumber(0);
+                int modulo = locationCounter % arg;
+                if( modulo != 0){
+                    locationCounter += arg - modulo;
+                    machineCode->appendZeros(arg - modulo);
                 }
-            case 8: /* .end */
-                writeMachineCodeToFile(machineCode, s->getName());
-                endOfProgram = true;
-                endOfLine = true;
                 break;
-            case 9:
-                {
-                    if(section != 0) writeMachineCodeToFile(machineCode, s->getName());
-                    locationCounter = 0;
-                    machineCode = "";
-                    s = symbolTable->findSymbol(token);
-                    section = s->getSymbolNo();
-                    rTables[section - 1] = new RelocationTable(token);
-                    token = nullptr;
-                    endOfLine = true;
-                    break;
+            }
+        case 7: /* .skip */
+            {
+                Token y = st.getNextToken();
+                int arg = y.parseNumber(0);
+                locationCounter += arg;
+                machineCode->appendZeros(arg);
+                break;
+            }
+        case 8: /* .end */
+            break;
+        case 9:
+            {
+                locationCounter = 0;
+                Symbol *s = symbolTable->findSymbol(statement.token, statement.tokenLength);
+                section = s->getSymbolNo();
+                machineCode = &sectionCode[section];
+                rTables[section - 1]->reserve(relocationHints[section]);
+                break;
+            }
+        case 10: /* instructions */
+            {
+                locationCounter += 4;
+                const char *operands = statement.operands;
+                int length = statement.operandsLength;
+                while(length > 0 && operands[0] == ' '){
+                    operands++;
+                    length--;
                 }
-            case 10: /* instructions */
-                {
+                while(length > 0 && operands[length - 1] == ' ') length--;
+
+                /* same operands give the same code, only pc relative
+                   displacement is computed again */
+                unsigned long long x;
+                int cachedTokens;
+                unsigned int h = EncodingCache::hash(statement.mnemonicNo, operands, length);
+                if(encodingCache.find(h, statement.mnemonicNo, operands, length, locationCounter, x, cachedTokens)){
+                    tokens += cachedTokens;
+                }else{
+                    CachedEncoding cached;
+                    x = createMachineCode(statement.mnemonicNo, &st, rTables[section - 1], locationCounter, cached);
+                    encodingCache.insert(h, statement.mnemonicNo, operands, length, cached, st.getNumberOfTokens());
+                }
+                if(statement.mnemonicNo / NUMBER_OF_CONDITIONS == 20){
                     locationCounter += 4;
-                    endOfLine = true;
-                    unsigned long long x = createMachineCode(token, st, rTables[section - 1], locationCounter);
-                    if(token[0] == 'l' && token[1] == 'd' && token[2] == 'c' && strlen(token) == 5){
-                        locationCounter += 4;
-                        machineCode += convertDecimalToHex(x, 8);
-                    }else{
-                        machineCode += convertDecimalToHex(x, 4);
-                    }
-                    break;
+                    machineCode->appendBigEndian(x, 8);
+                }else{
+                    machineCode->appendBigEndian(x, 4);
                 }
-            default:
-                throw Error(20);
-                endOfLine = true;
                 break;
             }
-            delete token;
+        default:
+            throw Error(20);
+            break;
         }
-
-        delete st;
-        line = readLine();
+        tokens += st.getNumberOfTokens();
+    }
+    if(statistics){
+        statistics->tokens += tokens;
+        statistics->encodingHits += encodingCache.getHits();
+        statistics->encodingMisses += encodingCache.getMisses();
     }
-    for(int i = 0; i < symbolTable->getLastSectionID(); i++) rTables[i]->writeTableToFile(outputFileStream);
-    symbolTable->saveToFile(outputFileStream);
 }
 
 /*
- * This method formats and writes machine code
- * to a given file.
+ * This method formats machine code of a section
+ * into output buffer and writes it with one call.
  */
- void Assembly::writeMachineCodeToFile(string code, char *section){
+void Assembly::writeMachineCodeToFile(MachineCode& code, const char *section){
 
-    outputFileStream << endl << endl << '#';
-    for(unsigned int i = 0; i < strlen(section); i++) outputFileStream << section[i];
-    outputFileStream << endl;
-    for(unsigned int i = 1, j = 0; i <= code.length(); i++){
-        outputFileStream << code[i - 1];
-        j++;
-        if(i % 2 == 0 && i != 1){
-            outputFileStream << " ";
-            j++;
-        }
-        if(j == 24){
-            outputFileStream << endl;
-            j = 0;
-        }
-    }
- }
+    formatMachineCode(code, section, outputBuffer);
+    writeOutputBuffer();
+}
+
+/*
+ * Formats code of a section with its header
+ * into given buffer.
+ */
+void Assembly::formatMachineCode(MachineCode& code, const char *section, OutputBuffer& buffer){
+
+    buffer.reserve(strlen(section) + 4 + 3 * code.getSize() + code.getSize() / 8);
+    buffer.append("\n\n#");
+    buffer.append(section);
+    buffer.append('\n');
+    code.formatHex(buffer);
+}
@@ -3,6 +3,14 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
+#include "InputFile.h"
+#include "Statement.h"
+#include "Chunk.h"
+#include "MachineCode.h"
+#include "OutputBuffer.h"
+#include "Encoding.h"
+#include "SpscQueue.h"
 
 using namespace std;
 
@@ -10,54 +18,126 @@ class SymbolTable;
 
 class StringTokenizer;
 
+struct Token;
+
 class RelocationTable;
 
+class Statistics;
+
+class IncrementalCache;
+
+struct CachedEncoding;
+
 class Assembly{
 
 public:
 
-    Assembly(char*, char*);
+    Assembly();
+
+    Assembly(const char*, const char*);
 
     ~Assembly();
 
-    char* readLine();
+    void assemble(const char*, long);
+
+    int getNumberOfSections();
+
+    MachineCode& getSectionCode(int);
+
+    RelocationTable* getRelocationTable(int);
+
+    SymbolTable* getSymbolTable();
 
     void createOutputFile();
 
-    int determineTypeOfToken(char*);
+    void setBinaryOutput(bool);
+
+    void setNumberOfThreads(int);
+
+    void setStatistics(Statistics*);
+
+    void setCacheFile(const char*);
+
+    void setPipeline(bool);
+
+    int determineTypeOfToken(const Token&);
+
+    int determineTypeOfToken(const Token&, int&);
 
     void firstPass();
 
+    void scanChunk(Chunk&);
+
+    void mergeChunk(Chunk&, int&, int&);
+
     void secondPass();
 
-    unsigned long long createMachineCode(char*, StringTokenizer*, RelocationTable*, int);
+    void encodeSections();
+
+    void runPipeline();
+
+    unsigned long long hashStatements(unsigned int, unsigned int);
+
+    bool restoreSection(IncrementalCache&, const Statement&, unsigned long long);
+
+    void encodeStatements(unsigned int, unsigned int);
 
-    string convertDecimalToHex(unsigned long long, int);
+    unsigned long long createMachineCode(int, StringTokenizer*, RelocationTable*, int, CachedEncoding&);
 
-    void writeMachineCodeToFile(string, char*);
+    void writeMachineCodeToFile(MachineCode&, const char*);
+
+    void formatMachineCode(MachineCode&, const char*, OutputBuffer&);
+
+    void writeOutputBuffer();
 
 private:
 
-    static const int LINE_LENGTH;
+    static bool matches(const char*, int, const char*);
+
+    static int lookupDirective(const char*, int);
+
+    static int lookupCondition(const char*, int);
+
+    static int lookupMnemonic(const char*, int);
+
     static const int NUMBER_OF_DIRECTIVES = 7;
     static const int NUMBER_OF_MNEMONICS = 147;
     static const int NUMBER_OF_SECTIONS = 3;
     static const int NUMBER_OF_INSTRUCTIONS = 21;
     static const int NUMBER_OF_CONDITIONS = 7;
+    static const long MINIMUM_CHUNK_SIZE = 1 << 18;
+    static const int CHUNKS_PER_THREAD = 4;
+    static const int PIPELINE_BUFFERS = 4;
+    static const int PIPELINE_QUEUE_SIZE = 16;
     static const char *sections[NUMBER_OF_SECTIONS];
     static const char *directives[NUMBER_OF_DIRECTIVES];
     static const char *mnemonics[NUMBER_OF_MNEMONICS];
     static const char *instructions[NUMBER_OF_INSTRUCTIONS];
     static const char *conditions[NUMBER_OF_CONDITIONS];
+    static const InstructionEncoding encodings[NUMBER_OF_INSTRUCTIONS];
 
-    char *inputFileName;
-    char *outputFileName;
-    ifstream inputFileStream;
+    const char *inputFileName;
+    const char *outputFileName;
+    InputFile inputFile;
+    vector<Statement> statements;
     ofstream outputFileStream;
+    ostream *output;
+    OutputBuffer outputBuffer;
     SymbolTable *symbolTable;
     bool endOfProgram;
 
-    RelocationTable **rTables;
+    vector<Chunk> chunks;
+    vector<RelocationTable*> rTables;
+    vector<MachineCode> sectionCode;
+    vector<int> relocationHints;
+    int completeSections;
+    bool binaryOutput;
+    int numberOfThreads;
+    Statistics *statistics;
+    const char *cacheFileName;
+    bool pipeline;
+    bool outputWritten;
+    SpscQueue<int> *encodedSections;
 
     static const int PUBLIC;
     static const int EXTERN;
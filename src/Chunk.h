@@ -0,0 +1,68 @@
+#ifndef CHUNK
+#define CHUNK
+
+#include <vector>
+#include <exception>
+#include "Statement.h"
+
+using namespace std;
+
+/*
+ * Part of a chunk where location counter grows by
+ * known amounts. Chunk starts with a segment whose
+ * base is where previous chunk ended; section and
+ * .align directives start new segments, whose bases
+ * are zero or the aligned end of previous segment.
+ * Number of relocations its statements may need is
+ * counted so relocation tables can be reserved.
+ */
+struct Segment{
+
+    static const int START = 0;
+    static const int SECTION = 1;
+    static const int ALIGN = 2;
+
+    int kind;
+    int alignment;
+    int length;
+    int base;
+    int section;
+    int relocations;
+};
+
+/*
+ * Symbol found while scanning a chunk. Symbols are
+ * put into symbol table in the order they were
+ * found, once offsets of their segments are known.
+ */
+struct SymbolEvent{
+
+    const char *name;
+    int length;
+    int type;
+    int segment;
+    int offset;
+};
+
+/*
+ * Range of input lines scanned by one thread in the
+ * first pass. Location counters of its statements
+ * are relative to their segment, and instead of
+ * section they hold index of that segment, until
+ * chunks are put together.
+ */
+struct Chunk{
+
+    long begin;
+    long end;
+    vector<Statement> statements;
+    vector<Segment> segments;
+    vector<SymbolEvent> events;
+    bool endOfProgram;
+    long lines;
+    long tokens;
+    unsigned int eventsBeforeError;
+    exception_ptr error;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef ENCODING
+#define ENCODING
+
+/*
+ * How one operand of an instruction is encoded.
+ * Register or constant goes to position; operands
+ * that can take two forms put the second one at
+ * alternativePosition and add alternativeBits.
+ * Label and symbol forms encode displacement from
+ * pc, cut to displacementMask. Registers whose bit
+ * is set in forbiddenRegisters can't be used.
+ */
+struct OperandEncoding{
+
+    static const int NONE = 0;
+    static const int INTERRUPT = 1;
+    static const int REGISTER = 2;
+    static const int CONSTANT = 3;
+    static const int REGISTER_OR_CONSTANT = 4;
+    static const int REGISTER_OR_LABEL = 5;
+    static const int REGISTER_OR_SYMBOL = 6;
+    static const int ADDRESSING_MODE = 7;
+    static const int CONSTANT_OR_SYMBOL = 8;
+
+    int kind;
+    int position;
+    unsigned int forbiddenRegisters;
+    int alternativePosition;
+    unsigned int alternativeBits;
+    unsigned int displacementMask;
+};
+
+/*
+ * Fixed bits of an instruction (without condition),
+ * its operands in order and error reported when
+ * there are more operands than that. Zero means
+ * extra operands are ignored.
+ */
+struct InstructionEncoding{
+
+    static const int MAX_OPERANDS = 4;
+
+    unsigned int opcode;
+    int trailingError;
+    OperandEncoding operands[MAX_OPERANDS];
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "EncodingCache.h"
+#include "Symbol.h"
+#include <cstring>
+
+using namespace std;
+
+/*
+ * Table is allocated on first insert, so ranges
+ * without instructions cost nothing.
+ */
+EncodingCache::EncodingCache(){
+
+    entries = nullptr;
+    capacity = 0;
+    size = 0;
+    hits = misses = 0;
+}
+
+EncodingCache::~EncodingCache(){
+
+    delete [] entries;
+}
+
+/*
+ * FNV-1a hash of operand text, started with
+ * the mnemonic.
+ */
+unsigned int EncodingCache::hash(int mnemonicNo, const char* operands, int length){
+
+    unsigned int h = 2166136261u ^ mnemonicNo;
+    h *= 16777619u;
+    for(int i = 0; i < length; i++){
+        h ^= (unsigned char)operands[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Looks for the instruction and gives its machine
+ * code at given pc and the number of tokens it had.
+ * Returns false if the instruction hasn't been
+ * cached yet.
+ */
+bool EncodingCache::find(unsigned int h, int mnemonicNo, const char* operands, int length, int pc, unsigned long long& machineCode, int& tokens){
+
+    if(entries != nullptr){
+        for(unsigned int i = h & (capacity - 1); entries[i].mnemonicNo >= 0; i = (i + 1) & (capacity - 1)){
+            const Entry &entry = entries[i];
+            if(entry.mnemonicNo != mnemonicNo || entry.length != length) continue;
+            if(length != 0 && memcmp(entry.operands, operands, length) != 0) continue;
+            machineCode = entry.encoding.machineCode;
+            if(entry.encoding.symbol) machineCode += (entry.encoding.symbol->getOffset() - pc) & entry.encoding.displacementMask;
+            tokens = entry.tokens;
+            hits++;
+            return true;
+        }
+    }
+    misses++;
+    return false;
+}
+
+/*
+ * Adds instruction that wasn't found. When the
+ * cache is full, instructions are not added any
+ * more.
+ */
+void EncodingCache::insert(unsigned int h, int mnemonicNo, const char* operands, int length, const CachedEncoding& encoding, int tokens){
+
+    if(!encoding.cacheable || size >= MAXIMUM_SIZE) return;
+    if(2 * (size + 1) > capacity) grow();
+    unsigned int i = h & (capacity - 1);
+    while(entries[i].mnemonicNo >= 0) i = (i + 1) & (capacity - 1);
+    Entry &entry = entries[i];
+    entry.operands = operands;
+    entry.length = length;
+    entry.mnemonicNo = mnemonicNo;
+    entry.tokens = tokens;
+    entry.encoding = encoding;
+    size++;
+}
+
+/*
+ * Doubles the table and puts entries back
+ * at their new positions. Free entries have
+ * negative mnemonic.
+ */
+void EncodingCache::grow(){
+
+    Entry *old = entries;
+    unsigned int oldCapacity = capacity;
+    capacity = capacity ? 2 * capacity : INITIAL_CAPACITY;
+    entries = new Entry[capacity];
+    for(unsigned int i = 0; i < capacity; i++) entries[i].mnemonicNo = -1;
+    for(unsigned int i = 0; i < oldCapacity; i++){
+        if(old[i].mnemonicNo < 0) continue;
+        unsigned int j = hash(old[i].mnemonicNo, old[i].operands, old[i].length) & (capacity - 1);
+        while(entries[j].mnemonicNo >= 0) j = (j + 1) & (capacity - 1);
+        entries[j] = old[i];
+    }
+    delete [] old;
+}
+
+long EncodingCache::getHits(){
+
+    return hits;
+}
+
+long EncodingCache::getMisses(){
+
+    return misses;
+}
@@ -0,0 +1,73 @@
+#ifndef ENCODINGCACHE
+#define ENCODINGCACHE
+
+class Symbol;
+
+/*
+ * Instruction as createMachineCode encoded it.
+ * Instructions with a pc relative label or symbol
+ * keep the symbol, and the displacement is added
+ * to machineCode with displacementMask for every
+ * pc. Instructions that made relocations can't be
+ * cached.
+ */
+struct CachedEncoding{
+
+    bool cacheable;
+    unsigned long long machineCode;
+    Symbol *symbol;
+    unsigned int displacementMask;
+};
+
+/*
+ * Machine code of instructions already encoded,
+ * found by mnemonic and operand text. Operands
+ * are slices of the input, which outlives the
+ * cache, so they are not copied. Cache is used
+ * by one thread only.
+ */
+class EncodingCache{
+
+public:
+
+    EncodingCache();
+
+    ~EncodingCache();
+
+    static unsigned int hash(int, const char*, int);
+
+    bool find(unsigned int, int, const char*, int, int, unsigned long long&, int&);
+
+    void insert(unsigned int, int, const char*, int, const CachedEncoding&, int);
+
+    long getHits();
+
+    long getMisses();
+
+private:
+
+    struct Entry{
+        const char *operands;
+        int length;
+        int mnemonicNo;
+        int tokens;
+        CachedEncoding encoding;
+    };
+
+    void grow();
+
+    static const unsigned int INITIAL_CAPACITY = 1024;
+    static const unsigned int MAXIMUM_SIZE = 1 << 16;
+
+    Entry *entries;
+    unsigned int capacity;
+    unsigned int size;
+    long hits;
+    long misses;
+
+    EncodingCache(const EncodingCache&);
+
+    EncodingCache& operator=(const EncodingCache&);
+};
+
+#endif
@@ -49,4 +49,5 @@ string Error::errorMessages[] = {
     "Incorrect syntax",
     ".long directive must contain at least one argument.",
     "Couldn't parse instruction.",
+    "Error writing output file.",
 };
@@ -19,7 +19,7 @@ public:
 
 private:
 
-    static const int NUMBER_OF_MESSAGES = 23;
+    static const int NUMBER_OF_MESSAGES = 24;
 
     static string errorMessages[NUMBER_OF_MESSAGES];
 
@@ -0,0 +1,112 @@
+#include "HexFormatter.h"
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+/*
+ * Two hexadecimal digits for every byte value,
+ * so each byte is formatted with one lookup.
+ */
+const char HexFormatter::hexPairs[] =
+    "000102030405060708090A0B0C0D0E0F"
+    "101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F"
+    "303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F"
+    "505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F"
+    "707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F"
+    "909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+/*
+ * Every byte takes two digits and a space,
+ * and every eighth byte ends a line.
+ */
+size_t HexFormatter::getFormattedSize(size_t n){
+
+    return 3 * n + n / 8;
+}
+
+/*
+ * Formats n bytes as "XX " with a new line after
+ * every eighth byte. Output must have room for
+ * getFormattedSize(n) characters.
+ */
+void HexFormatter::formatBytesScalar(const unsigned char* bytes, size_t n, char* out){
+
+    for(size_t i = 0; i < n; i++){
+        const char *pair = hexPairs + 2 * bytes[i];
+        *out++ = pair[0];
+        *out++ = pair[1];
+        *out++ = ' ';
+        if(i % 8 == 7) *out++ = '\n';
+    }
+}
+
+/*
+ * Same as formatBytesScalar, but with SSE2 sixteen
+ * bytes (two lines) are turned into digits at once.
+ * Each digit pair is padded to four characters and
+ * stored so that the next pair or the new line
+ * overwrites the extra space. Bytes left over are
+ * formatted by the scalar loop.
+ */
+void HexFormatter::formatBytes(const unsigned char* bytes, size_t n, char* out){
+
+#ifdef __SSE2__
+    const __m128i lowNibble = _mm_set1_epi8(0x0F);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i letterOffset = _mm_set1_epi8('A' - '9' - 1);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i spaces = _mm_set1_epi8(' ');
+    unsigned int slots[16];
+
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(bytes + i));
+        __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), lowNibble);
+        __m128i low = _mm_and_si128(v, lowNibble);
+        high = _mm_add_epi8(_mm_add_epi8(high, zero), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letterOffset));
+        low = _mm_add_epi8(_mm_add_epi8(low, zero), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letterOffset));
+        __m128i first = _mm_unpacklo_epi8(high, low);
+        __m128i second = _mm_unpackhi_epi8(high, low);
+        _mm_storeu_si128((__m128i*)slots, _mm_unpacklo_epi16(first, spaces));
+        _mm_storeu_si128((__m128i*)(slots + 4), _mm_unpackhi_epi16(first, spaces));
+        _mm_storeu_si128((__m128i*)(slots + 8), _mm_unpacklo_epi16(second, spaces));
+        _mm_storeu_si128((__m128i*)(slots + 12), _mm_unpackhi_epi16(second, spaces));
+        for(int j = 0; j < 8; j++) memcpy(out + 3 * j, slots + j, 4);
+        out[24] = '\n';
+        for(int j = 0; j < 8; j++) memcpy(out + 25 + 3 * j, slots + 8 + j, 4);
+        out[49] = '\n';
+        out += 50;
+    }
+    formatBytesScalar(bytes + i, n - i, out);
+#else
+    formatBytesScalar(bytes, n, out);
+#endif
+}
+
+/*
+ * Writes lowest digits hexadecimal digits of
+ * value, most significant first.
+ */
+void HexFormatter::formatNumber(unsigned long long value, int digits, char* out){
+
+    for(int i = digits - 2; i >= 0; i -= 2){
+        const char *pair = hexPairs + 2 * (value & 255);
+        out[i] = pair[0];
+        out[i + 1] = pair[1];
+        value >>= 8;
+    }
+    if(digits % 2) out[0] = hexPairs[2 * (value & 15) + 1];
+}
@@ -0,0 +1,30 @@
+#ifndef HEXFORMATTER
+#define HEXFORMATTER
+
+#include <cstddef>
+
+using namespace std;
+
+/*
+ * Formats bytes and numbers as upper case
+ * hexadecimal text, the way they appear in
+ * text output.
+ */
+class HexFormatter{
+
+public:
+
+    static size_t getFormattedSize(size_t);
+
+    static void formatBytes(const unsigned char*, size_t, char*);
+
+    static void formatBytesScalar(const unsigned char*, size_t, char*);
+
+    static void formatNumber(unsigned long long, int, char*);
+
+private:
+
+    static const char hexPairs[];
+};
+
+#endif
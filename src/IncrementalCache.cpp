@@ -0,0 +1,198 @@
+#include "IncrementalCache.h"
+#include "MachineCode.h"
+#include "RelocationTable.h"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace std;
+
+IncrementalCache::IncrementalCache(){
+
+}
+
+IncrementalCache::~IncrementalCache(){
+
+}
+
+/*
+ * FNV-1a hash of given bytes, continuing
+ * from hash of what came before them.
+ */
+unsigned long long IncrementalCache::hash(const char* data, int length, unsigned long long h){
+
+    for(int i = 0; i < length; i++){
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+unsigned long long IncrementalCache::hash(int value, unsigned long long h){
+
+    return hash((const char*)&value, sizeof(value), h);
+}
+
+void IncrementalCache::addSection(const char* name, unsigned long long hash, MachineCode& code, RelocationTable* table){
+
+    CachedSection section;
+    section.name = name;
+    section.hash = hash;
+    section.bytes.assign(code.getData(), code.getData() + code.getSize());
+    for(int i = 0; i < table->getSize(); i++){
+        section.offsets.push_back(table->getOffset(i));
+        section.types.push_back(table->getType(i));
+        section.values.push_back(table->getValue(i));
+    }
+    sections.push_back(section);
+}
+
+/*
+ * Returns index of section with given name whose
+ * statements had given hash, or -1.
+ */
+int IncrementalCache::findSection(const char* name, unsigned long long hash){
+
+    for(unsigned int i = 0; i < sections.size(); i++)
+        if(sections[i].hash == hash && sections[i].name == name) return i;
+    return -1;
+}
+
+/*
+ * Copies bytes and relocations of cached
+ * section into empty code and table.
+ */
+void IncrementalCache::restoreSection(int i, MachineCode& code, RelocationTable* table){
+
+    const CachedSection &section = sections[i];
+    if(!section.bytes.empty()) code.appendBytes(&section.bytes[0], section.bytes.size());
+    table->reserve(section.offsets.size());
+    for(unsigned int j = 0; j < section.offsets.size(); j++)
+        table->insertNewEntry(section.offsets[j], (RelocationTable::Type)section.types[j], section.values[j]);
+}
+
+static void writeNumber(ofstream& file, unsigned long long value){
+
+    file.write((const char*)&value, sizeof(value));
+}
+
+static void writeString(ofstream& file, const string& text){
+
+    writeNumber(file, text.size());
+    file.write(text.data(), text.size());
+}
+
+static bool readNumber(ifstream& file, unsigned long long& value){
+
+    return (bool)file.read((char*)&value, sizeof(value));
+}
+
+/*
+ * Number of bytes from the read position to
+ * the end of file of given size.
+ */
+static unsigned long long bytesLeft(ifstream& file, unsigned long long fileSize){
+
+    unsigned long long position = file.tellg();
+    return position < fileSize ? fileSize - position : 0;
+}
+
+static bool readString(ifstream& file, string& text, unsigned long long fileSize){
+
+    unsigned long long length;
+    if(!readNumber(file, length) || length > bytesLeft(file, fileSize)) return false;
+    text.resize(length);
+    return length == 0 || (bool)file.read(&text[0], length);
+}
+
+/*
+ * Writes cache to file. Numbers are written as
+ * they are in memory, since cache is only read
+ * back by the same program on the same machine.
+ * File is written under a temporary name and
+ * renamed, so an interrupted run never leaves a
+ * half written cache behind.
+ */
+bool IncrementalCache::save(const char* fileName){
+
+    char suffix[32];
+    sprintf(suffix, ".%ld.tmp", (long)getpid());
+    string temporary = string(fileName) + suffix;
+    {
+        ofstream file(temporary.c_str(), ofstream::binary);
+        if(!file.is_open()) return false;
+        file.write("TPAC", 4);
+        writeNumber(file, VERSION);
+        writeNumber(file, ENCODER_VERSION);
+        writeNumber(file, sections.size());
+        for(unsigned int i = 0; i < sections.size(); i++){
+            const CachedSection &section = sections[i];
+            writeString(file, section.name);
+            writeNumber(file, section.hash);
+            writeNumber(file, section.bytes.size());
+            if(!section.bytes.empty()) file.write((const char*)&section.bytes[0], section.bytes.size());
+            writeNumber(file, section.offsets.size());
+            for(unsigned int j = 0; j < section.offsets.size(); j++){
+                writeNumber(file, section.offsets[j]);
+                writeNumber(file, section.types[j]);
+                writeNumber(file, section.values[j]);
+            }
+        }
+        file.close();
+        if(!file){
+            unlink(temporary.c_str());
+            return false;
+        }
+    }
+    if(rename(temporary.c_str(), fileName) != 0){
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Reads cache written by save. Missing or damaged
+ * file, or file written by a different encoder,
+ * gives false, and everything is encoded again.
+ * Sizes and counts are checked against bytes left
+ * in the file before anything is allocated for them.
+ */
+bool IncrementalCache::load(const char* fileName){
+
+    ifstream file(fileName, ifstream::binary | ifstream::ate);
+    if(!file.is_open()) return false;
+    unsigned long long fileSize = file.tellg();
+    file.seekg(0);
+    char magic[4];
+    unsigned long long value, count;
+    if(!file.read(magic, 4) || memcmp(magic, "TPAC", 4) != 0) return false;
+    if(!readNumber(file, value) || value != VERSION) return false;
+    if(!readNumber(file, value) || value != ENCODER_VERSION) return false;
+
+    /* smallest section is its name length, hash, size and number of entries */
+    if(!readNumber(file, count) || count > bytesLeft(file, fileSize) / (4 * sizeof(value))) return false;
+    sections.clear();
+    for(unsigned long long i = 0; i < count; i++){
+        CachedSection section;
+        unsigned long long size, entries;
+        if(!readString(file, section.name, fileSize) || !readNumber(file, section.hash) || !readNumber(file, size)) return false;
+        if(size > bytesLeft(file, fileSize)) return false;
+        section.bytes.resize(size);
+        if(size && !file.read((char*)&section.bytes[0], size)) return false;
+        if(!readNumber(file, entries) || entries > bytesLeft(file, fileSize) / (3 * sizeof(value))) return false;
+        section.offsets.reserve(entries);
+        section.types.reserve(entries);
+        section.values.reserve(entries);
+        for(unsigned long long j = 0; j < entries; j++){
+            unsigned long long offset, type, relocationValue;
+            if(!readNumber(file, offset) || !readNumber(file, type) || !readNumber(file, relocationValue) || type > 3) return false;
+            section.offsets.push_back(offset);
+            section.types.push_back(type);
+            section.values.push_back(relocationValue);
+        }
+        sections.push_back(section);
+    }
+    return true;
+}
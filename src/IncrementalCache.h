@@ -0,0 +1,63 @@
+#ifndef INCREMENTALCACHE
+#define INCREMENTALCACHE
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class MachineCode;
+
+class RelocationTable;
+
+/*
+ * What one run of the second pass produced, kept
+ * in a file next to the output: for every section,
+ * hash of its statements and of the symbols they
+ * refer to, its bytes and its relocations. Sections
+ * with the same hash can be copied instead of
+ * encoded again.
+ */
+class IncrementalCache{
+
+public:
+
+    IncrementalCache();
+
+    ~IncrementalCache();
+
+    bool load(const char*);
+
+    bool save(const char*);
+
+    void addSection(const char*, unsigned long long, MachineCode&, RelocationTable*);
+
+    int findSection(const char*, unsigned long long);
+
+    void restoreSection(int, MachineCode&, RelocationTable*);
+
+    static unsigned long long hash(const char*, int, unsigned long long);
+
+    static unsigned long long hash(int, unsigned long long);
+
+    /* change whenever the same statements give different bytes or relocations */
+    static const unsigned int ENCODER_VERSION = 1;
+
+private:
+
+    struct CachedSection{
+        string name;
+        unsigned long long hash;
+        vector<unsigned char> bytes;
+        vector<int> offsets;
+        vector<unsigned char> types;
+        vector<int> values;
+    };
+
+    /* layout of the cache file */
+    static const unsigned int VERSION = 2;
+
+    vector<CachedSection> sections;
+};
+
+#endif
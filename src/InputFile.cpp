@@ -0,0 +1,181 @@
+#include "InputFile.h"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+InputFile::InputFile(){
+
+    data = nullptr;
+    size = 0;
+    capacity = 0;
+    mapped = false;
+}
+
+InputFile::~InputFile(){
+
+    close();
+}
+
+/*
+ * This method maps whole input file into memory.
+ * Byte right after the last one is always readable
+ * and equal to zero: when file size is not multiple
+ * of page size, kernel fills the rest of the last
+ * page with zeros; otherwise the file is read into
+ * a buffer one byte larger than the file.
+ * Name "-" means standard input. It and files
+ * that aren't regular, like named pipes, are read
+ * to their end.
+ */
+bool InputFile::open(const char* fileName){
+
+    close();
+    if(strcmp(fileName, "-") == 0) return readStream(STDIN_FILENO);
+    int fd = ::open(fileName, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        ::close(fd);
+        return false;
+    }
+    /* pipes and devices have no size, they are read to the end */
+    if(!S_ISREG(info.st_mode)){
+        bool success = readStream(fd);
+        ::close(fd);
+        return success;
+    }
+    size = info.st_size;
+
+    if(size % sysconf(_SC_PAGESIZE) != 0){
+        void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(address != MAP_FAILED){
+            data = (char*)address;
+            mapped = true;
+        }
+    }
+    if(!mapped){
+        data = new char[size + 1];
+        capacity = size + 1;
+        long done = 0;
+        while(done < size){
+            ssize_t n = read(fd, data + done, size - done);
+            if(n <= 0) break;
+            done += n;
+        }
+        size = done;
+        data[size] = '\0';
+    }
+    ::close(fd);
+    return true;
+}
+
+/*
+ * Reads everything from descriptor into a buffer
+ * that doubles when it gets full, since size of a
+ * pipe is not known in advance.
+ */
+bool InputFile::readStream(int fd){
+
+    capacity = INITIAL_STREAM_CAPACITY;
+    data = new char[capacity];
+    while(true){
+        if(size + 1 == capacity){
+            char *larger = new char[2 * capacity];
+            memcpy(larger, data, size);
+            delete [] data;
+            data = larger;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, data + size, capacity - 1 - size);
+        if(n == 0) break;
+        if(n < 0){
+            if(errno == EINTR) continue;
+            close();
+            return false;
+        }
+        size += n;
+    }
+    data[size] = '\0';
+    return true;
+}
+
+/*
+ * Releases the mapping or buffer holding the file.
+ */
+void InputFile::close(){
+
+    if(data){
+        if(mapped) munmap(data, size);
+        else delete [] data;
+    }
+    data = nullptr;
+    size = 0;
+    capacity = 0;
+    mapped = false;
+}
+
+/*
+ * Uses a copy of given bytes as the input, with
+ * zero after the last one like a file. Buffer is
+ * kept and reused for later inputs that fit in it.
+ */
+void InputFile::assign(const char* source, long length){
+
+    if(mapped || capacity < length + 1){
+        close();
+        data = new char[length + 1];
+        capacity = length + 1;
+    }
+    memcpy(data, source, length);
+    data[length] = '\0';
+    size = length;
+}
+
+long InputFile::getSize(){
+
+    return size;
+}
+
+const char* InputFile::getData(){
+
+    return data;
+}
+
+/*
+ * Returns position of the first line that starts
+ * at or after given position.
+ */
+long InputFile::findLineStart(long position){
+
+    if(position <= 0) return 0;
+    if(position >= size) return size;
+    const char *newLine = (const char*)memchr(data + position - 1, '\n', size - position + 1);
+    return newLine == nullptr ? size : newLine - data + 1;
+}
+
+/*
+ * Reads line starting at position, if position is
+ * before end, and moves position to the next line.
+ * Ranges of lines can be read this way by several
+ * threads at once.
+ */
+bool InputFile::readLine(long& position, long end, const char*& line, int& length){
+
+    if(position >= end) return false;
+    line = data + position;
+    const char *newLine = (const char*)memchr(line, '\n', size - position);
+    if(newLine == nullptr){
+        length = size - position;
+        position = size;
+    }else{
+        length = newLine - line;
+        position += length + 1;
+    }
+    return true;
+}
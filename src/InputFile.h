@@ -0,0 +1,38 @@
+#ifndef INPUTFILE
+#define INPUTFILE
+
+class InputFile{
+
+public:
+
+    InputFile();
+
+    ~InputFile();
+
+    bool open(const char*);
+
+    void assign(const char*, long);
+
+    void close();
+
+    long getSize();
+
+    const char* getData();
+
+    long findLineStart(long);
+
+    bool readLine(long&, long, const char*&, int&);
+
+private:
+
+    bool readStream(int);
+
+    static const long INITIAL_STREAM_CAPACITY = 1 << 16;
+
+    char *data;
+    long size;
+    long capacity;
+    bool mapped;
+};
+
+#endif
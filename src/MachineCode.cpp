@@ -0,0 +1,81 @@
+#include "MachineCode.h"
+#include "OutputBuffer.h"
+#include "HexFormatter.h"
+
+using namespace std;
+
+MachineCode::MachineCode(){
+
+}
+
+MachineCode::~MachineCode(){
+
+}
+
+void MachineCode::appendByte(unsigned char byte){
+
+    bytes.push_back(byte);
+}
+
+/*
+ * Appends lowest b bytes of value, most
+ * significant byte first.
+ */
+void MachineCode::appendBigEndian(unsigned long long value, int b){
+
+    for(int i = b - 1; i >= 0; i--) bytes.push_back((unsigned char)(value >> (8 * i)));
+}
+
+/*
+ * Appends lowest b bytes of value, least
+ * significant byte first.
+ */
+void MachineCode::appendLittleEndian(unsigned long long value, int b){
+
+    for(int i = 0; i < b; i++) bytes.push_back((unsigned char)(value >> (8 * i)));
+}
+
+/*
+ * Appends n zero bytes at once, used by
+ * .skip and .align directives.
+ */
+void MachineCode::appendZeros(int n){
+
+    if(n > 0) bytes.resize(bytes.size() + n, 0);
+}
+
+void MachineCode::appendBytes(const unsigned char* data, int n){
+
+    if(n > 0) bytes.insert(bytes.end(), data, data + n);
+}
+
+/*
+ * Empties the buffer but keeps its capacity
+ * for the next section.
+ */
+void MachineCode::clear(){
+
+    bytes.clear();
+}
+
+int MachineCode::getSize(){
+
+    return bytes.size();
+}
+
+const unsigned char* MachineCode::getData(){
+
+    return bytes.data();
+}
+
+/*
+ * This method appends hexadecimal dump of the
+ * buffer to result: every byte as two digits
+ * followed by a space, eight bytes per line.
+ */
+void MachineCode::formatHex(OutputBuffer& result){
+
+    size_t n = bytes.size();
+    char *out = result.extend(HexFormatter::getFormattedSize(n));
+    if(n) HexFormatter::formatBytes(&bytes[0], n, out);
+}
@@ -0,0 +1,42 @@
+#ifndef MACHINECODE
+#define MACHINECODE
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class OutputBuffer;
+
+class MachineCode{
+
+public:
+
+    MachineCode();
+
+    ~MachineCode();
+
+    void appendByte(unsigned char);
+
+    void appendBigEndian(unsigned long long, int);
+
+    void appendLittleEndian(unsigned long long, int);
+
+    void appendZeros(int);
+
+    void appendBytes(const unsigned char*, int);
+
+    void clear();
+
+    int getSize();
+
+    const unsigned char* getData();
+
+    void formatHex(OutputBuffer&);
+
+private:
+
+    vector<unsigned char> bytes;
+};
+
+#endif
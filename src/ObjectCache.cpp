@@ -0,0 +1,214 @@
+#include "ObjectCache.h"
+#include "IncrementalCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/*
+ * Directory is created if it doesn't exist yet.
+ * Size limit is in bytes.
+ */
+ObjectCache::ObjectCache(const char* directory, long maximumSize){
+
+    this->directory = directory;
+    this->maximumSize = maximumSize;
+    hits = misses = evictions = temporaryFiles = 0;
+    scanned = false;
+    totalSize = 0;
+    mkdir(directory, 0777);
+}
+
+ObjectCache::~ObjectCache(){
+
+}
+
+/*
+ * Key of the input is 128 bits written in hex: two
+ * FNV-1a hashes, the second one of bytes taken in
+ * reverse order, both started with the assembler
+ * and encoder versions, the format and the size of
+ * the input.
+ */
+string ObjectCache::makeKey(const char* data, long size, bool binaryOutput){
+
+    unsigned long long first = 14695981039346656037ull;
+    first = IncrementalCache::hash(VERSION, first);
+    first = IncrementalCache::hash(IncrementalCache::ENCODER_VERSION, first);
+    first = IncrementalCache::hash(binaryOutput ? 1 : 0, first);
+    first = IncrementalCache::hash((const char*)&size, sizeof(size), first);
+    unsigned long long second = first ^ 0x9e3779b97f4a7c15ull;
+    first = IncrementalCache::hash(data, size, first);
+    for(long i = size - 1; i >= 0; i--){
+        second ^= (unsigned char)data[i];
+        second *= 1099511628211ull;
+    }
+
+    char key[33];
+    sprintf(key, "%016llx%016llx", first, second);
+    return key;
+}
+
+string ObjectCache::makePath(const string& key){
+
+    return directory + "/" + key + ".obj";
+}
+
+/*
+ * Copies whole file. Returns false if either of
+ * files can't be opened or copying fails.
+ */
+bool ObjectCache::copyFile(const char* source, const char* destination){
+
+    int in = open(source, O_RDONLY);
+    if(in < 0) return false;
+    int out = open(destination, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(out < 0){
+        close(in);
+        return false;
+    }
+    char buffer[1 << 16];
+    bool success = true;
+    ssize_t n;
+    while(success && (n = read(in, buffer, sizeof(buffer))) != 0){
+        if(n < 0){
+            success = false;
+            break;
+        }
+        for(ssize_t done = 0; done < n; ){
+            ssize_t written = write(out, buffer + done, n - done);
+            if(written <= 0){
+                success = false;
+                break;
+            }
+            done += written;
+        }
+    }
+    close(in);
+    if(close(out) != 0) success = false;
+    return success;
+}
+
+/*
+ * Copies cached output for the key into output
+ * file. Returns false when there is none, and the
+ * input has to be assembled.
+ */
+bool ObjectCache::fetch(const string& key, const char* outputFileName){
+
+    string path = makePath(key);
+    if(!copyFile(path.c_str(), outputFileName)){
+        misses++;
+        return false;
+    }
+    utime(path.c_str(), nullptr);
+    hits++;
+    lock_guard<mutex> lock(filesMutex);
+    unordered_map<string, CachedFile>::iterator file = files.find(key);
+    if(file != files.end()){
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        file->second.time = getTime(now);
+    }
+    return true;
+}
+
+/*
+ * Puts copy of output file into the cache. Copy is
+ * made under a name no other job uses and renamed,
+ * so nobody sees a file that is half written.
+ */
+bool ObjectCache::store(const string& key, const char* outputFileName){
+
+    char suffix[64];
+    sprintf(suffix, ".%ld.%ld.tmp", (long)getpid(), temporaryFiles++);
+    string temporary = directory + "/" + key + suffix;
+    string path = makePath(key);
+    if(!copyFile(outputFileName, temporary.c_str()) || rename(temporary.c_str(), path.c_str()) != 0){
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0) return true;
+    lock_guard<mutex> lock(filesMutex);
+    if(!scanned) scan();
+    else{
+        CachedFile &file = files[key];
+        totalSize += info.st_size - file.size;
+        file.size = info.st_size;
+        file.time = getTime(info.st_mtim);
+    }
+    if(totalSize > maximumSize) evict();
+    return true;
+}
+
+long long ObjectCache::getTime(const struct timespec& time){
+
+    return time.tv_sec * 1000000000ll + time.tv_nsec;
+}
+
+/*
+ * Finds sizes and modification times of all
+ * cached files. Called with files locked.
+ */
+void ObjectCache::scan(){
+
+    scanned = true;
+    DIR *dir = opendir(directory.c_str());
+    if(dir == nullptr) return;
+    for(struct dirent *entry = readdir(dir); entry; entry = readdir(dir)){
+        int length = strlen(entry->d_name);
+        if(length < 4 || strcmp(entry->d_name + length - 4, ".obj") != 0) continue;
+        struct stat info;
+        if(stat((directory + "/" + entry->d_name).c_str(), &info) != 0) continue;
+        CachedFile file = {info.st_size, getTime(info.st_mtim)};
+        files[string(entry->d_name, length - 4)] = file;
+        totalSize += info.st_size;
+    }
+    closedir(dir);
+}
+
+/*
+ * Removes files used least recently until the
+ * cache fits into its size limit. Files other
+ * processes removed in the meantime are only
+ * forgotten. Called with files locked.
+ */
+void ObjectCache::evict(){
+
+    vector<pair<long long, string> > order;
+    for(unordered_map<string, CachedFile>::iterator i = files.begin(); i != files.end(); ++i)
+        order.push_back(make_pair(i->second.time, i->first));
+    sort(order.begin(), order.end());
+
+    for(unsigned int i = 0; i < order.size() && totalSize > maximumSize; i++){
+        if(unlink(makePath(order[i].second).c_str()) == 0) evictions++;
+        else if(errno != ENOENT) continue;
+        totalSize -= files[order[i].second].size;
+        files.erase(order[i].second);
+    }
+}
+
+long ObjectCache::getHits(){
+
+    return hits;
+}
+
+long ObjectCache::getMisses(){
+
+    return misses;
+}
+
+long ObjectCache::getEvictions(){
+
+    return evictions;
+}
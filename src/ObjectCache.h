@@ -0,0 +1,81 @@
+#ifndef OBJECTCACHE
+#define OBJECTCACHE
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <time.h>
+
+using namespace std;
+
+/*
+ * Directory of finished output files, named after
+ * hash of the input they were assembled from, the
+ * assembler version and the output format. Several
+ * jobs and processes can share one directory: files
+ * are written under a temporary name and renamed.
+ * When the directory grows over its size limit,
+ * files used least recently are removed. Every hit
+ * touches the file, so its modification time is the
+ * time of last use. Directory is scanned once, at
+ * the first store; after that sizes and times are
+ * kept up to date in memory, and files added by
+ * other processes meanwhile are only seen by the
+ * next run.
+ */
+class ObjectCache{
+
+public:
+
+    ObjectCache(const char*, long);
+
+    ~ObjectCache();
+
+    string makeKey(const char*, long, bool);
+
+    bool fetch(const string&, const char*);
+
+    bool store(const string&, const char*);
+
+    long getHits();
+
+    long getMisses();
+
+    long getEvictions();
+
+private:
+
+    string makePath(const string&);
+
+    static bool copyFile(const char*, const char*);
+
+    void scan();
+
+    void evict();
+
+    static long long getTime(const struct timespec&);
+
+    /* change whenever the same input gives different output;
+       changes of the encoder are covered by IncrementalCache::ENCODER_VERSION */
+    static const unsigned int VERSION = 1;
+
+    /* size and modification time in nanoseconds of a file in the directory */
+    struct CachedFile{
+        long size;
+        long long time;
+    };
+
+    string directory;
+    long maximumSize;
+    atomic<long> hits;
+    atomic<long> misses;
+    atomic<long> evictions;
+    atomic<long> temporaryFiles;
+    unordered_map<string, CachedFile> files;
+    bool scanned;
+    long totalSize;
+    mutex filesMutex;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "ObjectFileWriter.h"
+#include "MachineCode.h"
+#include "RelocationTable.h"
+#include "SymbolTable.h"
+#include "Symbol.h"
+#include <cstring>
+
+using namespace std;
+
+const int ObjectFileWriter::VERSION = 1;
+const int ObjectFileWriter::HEADER_SIZE = 20;
+const int ObjectFileWriter::SECTION_HEADER_SIZE = 20;
+const int ObjectFileWriter::RELOCATION_SIZE = 9;
+const int ObjectFileWriter::SYMBOL_SIZE = 17;
+
+ObjectFileWriter::ObjectFileWriter(){
+
+    symbolTable = nullptr;
+}
+
+ObjectFileWriter::~ObjectFileWriter(){
+
+}
+
+/*
+ * Sections are written in the order they are added.
+ */
+void ObjectFileWriter::addSection(MachineCode& code, RelocationTable* relocationTable){
+
+    sections.push_back(&code);
+    relocationTables.push_back(relocationTable);
+}
+
+void ObjectFileWriter::setSymbolTable(SymbolTable* symbolTable){
+
+    this->symbolTable = symbolTable;
+}
+
+void ObjectFileWriter::putByte(unsigned char byte){
+
+    buffer += (char)byte;
+}
+
+void ObjectFileWriter::putWord(unsigned int word){
+
+    char bytes[4] = {(char)word, (char)(word >> 8), (char)(word >> 16), (char)(word >> 24)};
+    buffer.append(bytes, 4);
+}
+
+/*
+ * Overwrites word that was reserved earlier,
+ * used for offsets known only later.
+ */
+void ObjectFileWriter::putWordAt(unsigned int position, unsigned int word){
+
+    for(int i = 0; i < 4; i++) buffer[position + i] = (char)(word >> (8 * i));
+}
+
+/*
+ * Adds name to string table and returns its offset.
+ */
+unsigned int ObjectFileWriter::addString(const char* name){
+
+    unsigned int offset = stringTable.size();
+    stringTable.append(name, strlen(name) + 1);
+    return offset;
+}
+
+/*
+ * This method lays out the whole object file in
+ * memory and then writes it with a single call.
+ */
+void ObjectFileWriter::writeToFile(ostream& file){
+
+    int numberOfSymbols = 0;
+    for(Symbol *s = symbolTable->getFirst(); s; s = s->getNext()) numberOfSymbols++;
+
+    int numberOfRelocations = 0;
+    unsigned int dataSize = 0;
+    for(unsigned int i = 0; i < sections.size(); i++){
+        dataSize += sections[i]->getSize();
+        numberOfRelocations += relocationTables[i]->getSize();
+    }
+    buffer.clear();
+    stringTable.clear();
+    buffer.reserve(HEADER_SIZE + SECTION_HEADER_SIZE * sections.size() + dataSize +
+                   RELOCATION_SIZE * numberOfRelocations + SYMBOL_SIZE * numberOfSymbols);
+
+    buffer.append("\x7fTPO", 4);
+    putWord(VERSION);
+    putWord(sections.size());
+    putWord(numberOfSymbols);
+    unsigned int stringTableSizePosition = buffer.size();
+    putWord(0);
+
+    /* section headers, offsets are filled in below */
+    unsigned int sectionHeaders = buffer.size();
+    for(unsigned int i = 0; i < sections.size(); i++){
+        putWord(addString(relocationTables[i]->getSectionName()));
+        putWord(0);
+        putWord(sections[i]->getSize());
+        putWord(0);
+        putWord(0);
+    }
+
+    for(unsigned int i = 0; i < sections.size(); i++){
+        putWordAt(sectionHeaders + SECTION_HEADER_SIZE * i + 4, buffer.size());
+        buffer.append((const char*)sections[i]->getData(), sections[i]->getSize());
+    }
+
+    for(unsigned int i = 0; i < sections.size(); i++){
+        RelocationTable *table = relocationTables[i];
+        putWordAt(sectionHeaders + SECTION_HEADER_SIZE * i + 12, buffer.size());
+        for(int j = 0; j < table->getSize(); j++){
+            putWord(table->getOffset(j));
+            putByte(table->getType(j));
+            putWord(table->getValue(j));
+        }
+        putWordAt(sectionHeaders + SECTION_HEADER_SIZE * i + 16, table->getSize());
+    }
+
+    for(Symbol *s = symbolTable->getFirst(); s; s = s->getNext()){
+        putWord(addString(s->getName()));
+        putWord(s->getSymbolNo());
+        putWord(s->getSection());
+        putWord(s->getOffset());
+        putByte(s->getVisibility());
+    }
+
+    putWordAt(stringTableSizePosition, stringTable.size());
+    buffer += stringTable;
+    file.write(buffer.data(), buffer.size());
+}
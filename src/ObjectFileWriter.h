@@ -0,0 +1,75 @@
+#ifndef OBJECTFILEWRITER
+#define OBJECTFILEWRITER
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class MachineCode;
+
+class RelocationTable;
+
+class SymbolTable;
+
+/*
+ * Writes binary object file. All numbers are
+ * little endian, records are packed:
+ *
+ *   header          magic "\x7fTPO", u32 version, u32 number of
+ *                   sections, u32 number of symbols, u32 size
+ *                   of string table
+ *   section header  u32 name, u32 data offset, u32 data size,
+ *                   u32 relocations offset, u32 number of
+ *                   relocations (one per section)
+ *   section data    raw bytes of all sections
+ *   relocation      u32 offset, u8 type, u32 value
+ *   symbol          u32 name, u32 symbol number, u32 section,
+ *                   u32 offset, u8 visibility ('l' or 'g')
+ *   string table    zero terminated names
+ *
+ * Offsets are from start of file, names are offsets
+ * into string table. Relocation types are R_32 (0),
+ * R_32_negative (1), R_16_high (2) and R_16_low (3).
+ */
+class ObjectFileWriter{
+
+public:
+
+    ObjectFileWriter();
+
+    ~ObjectFileWriter();
+
+    void addSection(MachineCode&, RelocationTable*);
+
+    void setSymbolTable(SymbolTable*);
+
+    void writeToFile(ostream&);
+
+    static const int VERSION;
+
+    static const int HEADER_SIZE;
+    static const int SECTION_HEADER_SIZE;
+    static const int RELOCATION_SIZE;
+    static const int SYMBOL_SIZE;
+
+private:
+
+    vector<MachineCode*> sections;
+    vector<RelocationTable*> relocationTables;
+    SymbolTable *symbolTable;
+
+    string buffer;
+    string stringTable;
+
+    void putByte(unsigned char);
+
+    void putWord(unsigned int);
+
+    void putWordAt(unsigned int, unsigned int);
+
+    unsigned int addString(const char*);
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "OutputBuffer.h"
+#include <cstring>
+
+using namespace std;
+
+OutputBuffer::OutputBuffer(){
+
+    data = nullptr;
+    size = 0;
+    capacity = 0;
+}
+
+OutputBuffer::~OutputBuffer(){
+
+    delete [] data;
+}
+
+/*
+ * Makes sure that at least given number of
+ * characters more fits without reallocating.
+ */
+void OutputBuffer::reserve(size_t n){
+
+    if(size + n <= capacity) return;
+    size_t newCapacity = capacity * 2 > size + n ? capacity * 2 : size + n;
+    char *newData = new char[newCapacity];
+    if(size) memcpy(newData, data, size);
+    delete [] data;
+    data = newData;
+    capacity = newCapacity;
+}
+
+/*
+ * Adds n characters to the end of buffer and
+ * returns where they start, so they can be
+ * filled in place.
+ */
+char* OutputBuffer::extend(size_t n){
+
+    reserve(n);
+    char *result = data + size;
+    size += n;
+    return result;
+}
+
+void OutputBuffer::append(char c){
+
+    *extend(1) = c;
+}
+
+void OutputBuffer::append(const char* text){
+
+    append(text, strlen(text));
+}
+
+void OutputBuffer::append(const char* text, size_t length){
+
+    memcpy(extend(length), text, length);
+}
+
+/*
+ * Writes text right aligned in field of given
+ * width, like setw does. Longer text is not cut.
+ */
+void OutputBuffer::appendRight(const char* text, int width){
+
+    size_t length = strlen(text);
+    size_t padding = length < (size_t)width ? width - length : 0;
+    char *out = extend(padding + length);
+    memset(out, ' ', padding);
+    memcpy(out + padding, text, length);
+}
+
+void OutputBuffer::appendRight(long value, int width){
+
+    char digits[24];
+    char *end = digits + sizeof(digits) - 1;
+    char *start = end;
+    *end = '\0';
+    unsigned long magnitude = value < 0 ? 0 - (unsigned long)value : value;
+    do{
+        *--start = '0' + magnitude % 10;
+        magnitude /= 10;
+    }while(magnitude);
+    if(value < 0) *--start = '-';
+    appendRight(start, width);
+}
+
+void OutputBuffer::appendRight(char c, int width){
+
+    char text[2] = {c, '\0'};
+    appendRight(text, width);
+}
+
+/*
+ * Writes whole buffer with one call and
+ * empties it. Memory is kept for reuse.
+ */
+void OutputBuffer::writeToFile(ostream& file){
+
+    file.write(data, size);
+    size = 0;
+}
+
+size_t OutputBuffer::getSize(){
+
+    return size;
+}
@@ -0,0 +1,48 @@
+#ifndef OUTPUTBUFFER
+#define OUTPUTBUFFER
+
+#include <fstream>
+#include <cstddef>
+
+using namespace std;
+
+class OutputBuffer{
+
+public:
+
+    OutputBuffer();
+
+    ~OutputBuffer();
+
+    void reserve(size_t);
+
+    char* extend(size_t);
+
+    void append(char);
+
+    void append(const char*);
+
+    void append(const char*, size_t);
+
+    void appendRight(const char*, int);
+
+    void appendRight(long, int);
+
+    void appendRight(char, int);
+
+    void writeToFile(ostream&);
+
+    size_t getSize();
+
+private:
+
+    char *data;
+    size_t size;
+    size_t capacity;
+
+    OutputBuffer(const OutputBuffer&);
+
+    OutputBuffer& operator=(const OutputBuffer&);
+};
+
+#endif
@@ -1,75 +1,115 @@
 #include "RelocationTable.h"
-#include "RelocationTableEntry.h"
+#include "OutputBuffer.h"
+#include "HexFormatter.h"
 #include <string>
 #include <iostream>
-#include <iomanip>
 #include <cstring>
 
 using namespace std;
 
+/*
+ * Names of relocation types as they are
+ * written in text output.
+ */
+const char *RelocationTable::typeNames[] = {
+    "R_32", "R_32_negative", "R_16_high", "R_16_low"
+};
+
 /*
  * Method used to insert new entry
- * in relocation table.
+ * in relocation table. Entries are kept
+ * as parallel arrays of offsets, types and
+ * values.
  */
-void RelocationTable::insertNewEntry(int offset, string type, int value){
+void RelocationTable::insertNewEntry(int offset, Type type, int value){
 
-    if(first == nullptr) first = last = new RelocationTableEntry(offset, type, value);
-    else{
-        RelocationTableEntry *newEntry = new RelocationTableEntry(offset, type, value);
-        last->setNext(newEntry);
-        last = newEntry;
-    }
+    offsets.push_back(offset);
+    types.push_back(type);
+    values.push_back(value);
 }
 
-RelocationTable::RelocationTable(char *sectionName){
+RelocationTable::RelocationTable(const char *sectionName){
 
     this->sectionName = sectionName;
-    first = last = nullptr;
 }
 
 RelocationTable::~RelocationTable(){
 
-    while(first){
-        last = first;
-        first = first->getNext();
-        delete last;
-    }
-    first = last = nullptr;
-    delete [] sectionName;
-    sectionName = nullptr;
 }
 
 /*
- * This method converts decimal number
- * to hexadecimal version.
+ * Empties the table for another section,
+ * keeping the memory of its entries.
  */
-string RelocationTable::convertDecimalToHex(unsigned long long decimal, int b){
-
-    string result = "";
-    for(int i = 0; i < 2 * b; i++){
-        unsigned long long tmp = decimal & 15;
-        tmp += tmp >= 10 ? 55 : 48;
-        result = (char)tmp + result;
-        decimal >>= 4;
-    }
-    return result;
+void RelocationTable::reset(const char *sectionName){
+
+    this->sectionName = sectionName;
+    offsets.clear();
+    types.clear();
+    values.clear();
+}
+
+/*
+ * Makes room for given number of entries,
+ * as estimated in the first pass.
+ */
+void RelocationTable::reserve(int numberOfEntries){
+
+    offsets.reserve(numberOfEntries);
+    types.reserve(numberOfEntries);
+    values.reserve(numberOfEntries);
 }
 
 /*
  * This method formats and writes the relocation
  * table to a file.
  */
-void RelocationTable::writeTableToFile(ofstream& file){
-
-    RelocationTableEntry *tmp = first;
-    file << endl << endl << '#';
-    for(unsigned int i = 0; i < strlen(sectionName); i++) file << sectionName[i];
-    file << endl;
-    file << endl << setw(10) << "Offset" << setw(15) << "Type" << setw(15) <<
-    "Value" << endl << endl;
-    while(tmp){
-        file << setw(10) << convertDecimalToHex(tmp->getOffset(), 4) << setw(15) << tmp->getType() << setw(15)
-        << tmp->getValue() << endl;
-        tmp = tmp->getNext();
+void RelocationTable::writeTableToFile(OutputBuffer& file){
+
+    file.append("\n\n#");
+    file.append(sectionName);
+    file.append("\n\n");
+    file.appendRight("Offset", 10);
+    file.appendRight("Type", 15);
+    file.appendRight("Value", 15);
+    file.append("\n\n");
+    for(unsigned int i = 0; i < offsets.size(); i++){
+        char offset[9];
+        HexFormatter::formatNumber(offsets[i], 8, offset);
+        offset[8] = '\0';
+        file.appendRight(offset, 10);
+        file.appendRight(typeNames[types[i]], 15);
+        file.appendRight((long)values[i], 15);
+        file.append('\n');
     }
 }
+
+const char* RelocationTable::getSectionName(){
+
+    return sectionName;
+}
+
+int RelocationTable::getSize(){
+
+    return offsets.size();
+}
+
+int RelocationTable::getOffset(int i){
+
+    return offsets[i];
+}
+
+RelocationTable::Type RelocationTable::getType(int i){
+
+    return (Type)types[i];
+}
+
+int RelocationTable::getValue(int i){
+
+    return values[i];
+}
+
+const char* RelocationTable::getTypeName(Type type){
+
+    return typeNames[type];
+}
@@ -3,29 +3,55 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
-class RelocationTableEntry;
+class OutputBuffer;
 
 class RelocationTable{
 
 public:
 
-    RelocationTable(char*);
+    enum Type{
+        R_32 = 0,
+        R_32_negative = 1,
+        R_16_high = 2,
+        R_16_low = 3
+    };
+
+    RelocationTable(const char*);
 
     ~RelocationTable();
 
-    void insertNewEntry(int, string, int);
+    void reset(const char*);
+
+    void reserve(int);
+
+    void insertNewEntry(int, Type, int);
+
+    void writeTableToFile(OutputBuffer&);
+
+    const char* getSectionName();
+
+    int getSize();
+
+    int getOffset(int);
+
+    Type getType(int);
+
+    int getValue(int);
 
-    void writeTableToFile(ofstream&);
+    static const char* getTypeName(Type);
 
 private:
 
-    char *sectionName;
-    RelocationTableEntry *first, *last;
+    static const char *typeNames[];
 
-    string convertDecimalToHex(unsigned long long decimal, int b);
+    const char *sectionName;
+    vector<int> offsets;
+    vector<unsigned char> types;
+    vector<int> values;
 };
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef SPSCQUEUE
+#define SPSCQUEUE
+
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+/*
+ * Bounded queue between exactly one producer thread
+ * and one consumer thread. Items live in a ring whose
+ * size is a power of two; producer owns tail and
+ * consumer owns head, so no locks are needed. Push
+ * waits while the queue is full and pop while it is
+ * empty, giving up the processor in between.
+ */
+template<class T> class SpscQueue{
+
+public:
+
+    explicit SpscQueue(unsigned int capacity){
+
+        unsigned int size = 1;
+        while(size < capacity) size *= 2;
+        items = new T[size];
+        mask = size - 1;
+        head = tail = 0;
+    }
+
+    ~SpscQueue(){
+
+        delete [] items;
+    }
+
+    void push(const T& item){
+
+        unsigned int t = tail.load(memory_order_relaxed);
+        while(t - head.load(memory_order_acquire) > mask) this_thread::yield();
+        items[t & mask] = item;
+        tail.store(t + 1, memory_order_release);
+    }
+
+    T pop(){
+
+        unsigned int h = head.load(memory_order_relaxed);
+        while(tail.load(memory_order_acquire) == h) this_thread::yield();
+        T item = items[h & mask];
+        head.store(h + 1, memory_order_release);
+        return item;
+    }
+
+private:
+
+    T *items;
+    unsigned int mask;
+
+    /* on separate cache lines, so the two threads don't fight over one */
+    alignas(64) atomic<unsigned int> head;
+    alignas(64) atomic<unsigned int> tail;
+
+    SpscQueue(const SpscQueue&);
+
+    SpscQueue& operator=(const SpscQueue&);
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef STATEMENT
+#define STATEMENT
+
+/*
+ * One line of the source as seen by the first pass:
+ * type of its first token (after labels), index of
+ * the mnemonic for instructions, section and location
+ * counter at start of the line, and slices of the
+ * input holding that token and the operands after it.
+ * Slices point into the mapped input file.
+ */
+struct Statement{
+
+    const char *token;
+    const char *operands;
+    int tokenLength;
+    int operandsLength;
+    int type;
+    int mnemonicNo;
+    int section;
+    int locationCounter;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "Statistics.h"
+
+using namespace std;
+
+atomic<long> Statistics::totalAllocations(0);
+atomic<long> Statistics::totalAllocatedBytes(0);
+
+Statistics::Statistics(){
+
+    firstPassTime = secondPassTime = outputTime = 0;
+    scanTime = mergeTime = encodeTime = writeTime = 0;
+    lines = statements = 0;
+    tokens = symbolHits = symbolMisses = 0;
+    encodingHits = encodingMisses = 0;
+    relocations = sectionBytes = outputBytes = reusedSections = 0;
+    objectCacheHits = objectCacheMisses = 0;
+    allocations = allocatedBytes = 0;
+    threads = 1;
+}
+
+/*
+ * Seconds since given point in time.
+ */
+double Statistics::elapsed(chrono::steady_clock::time_point start){
+
+    chrono::duration<double> time = chrono::steady_clock::now() - start;
+    return time.count();
+}
+
+long Statistics::getAllocations(){
+
+    return totalAllocations.load(memory_order_relaxed);
+}
+
+long Statistics::getAllocatedBytes(){
+
+    return totalAllocatedBytes.load(memory_order_relaxed);
+}
+
+/*
+ * Counts one heap allocation. Allocations are only
+ * counted by programs that call this from their own
+ * operator new, like the assembler with --stats;
+ * otherwise allocation counters stay zero.
+ */
+void Statistics::countAllocation(size_t size){
+
+    totalAllocations.fetch_add(1, memory_order_relaxed);
+    totalAllocatedBytes.fetch_add(size, memory_order_relaxed);
+}
+
+/*
+ * Counts one symbol table lookup that found
+ * a symbol or didn't.
+ */
+void Statistics::countLookup(bool found){
+
+    if(found) symbolHits.fetch_add(1, memory_order_relaxed);
+    else symbolMisses.fetch_add(1, memory_order_relaxed);
+}
+
+/*
+ * Escapes file name for a JSON string.
+ */
+static string quote(const string& text){
+
+    string result = "\"";
+    for(unsigned int i = 0; i < text.size(); i++){
+        char c = text[i];
+        if(c == '"' || c == '\\') result += '\\';
+        if((unsigned char)c < 32) result += ' ';
+        else result += c;
+    }
+    return result + "\"";
+}
+
+/*
+ * Writes statistics as one line of JSON. Times
+ * are in milliseconds.
+ */
+void Statistics::writeJson(ostream& out, const string& input, const string& output){
+
+    out << "{\"input\":" << quote(input) << ",\"output\":" << quote(output)
+        << ",\"threads\":" << threads
+        << ",\"time\":{\"firstPass\":" << firstPassTime * 1000
+        << ",\"secondPass\":" << secondPassTime * 1000
+        << ",\"output\":" << outputTime * 1000
+        << ",\"total\":" << (firstPassTime + secondPassTime + outputTime) * 1000
+        << "},\"phases\":{\"scan\":" << scanTime * 1000
+        << ",\"merge\":" << mergeTime * 1000
+        << ",\"encode\":" << encodeTime * 1000
+        << ",\"format\":" << (outputTime - writeTime) * 1000
+        << ",\"write\":" << writeTime * 1000
+        << "},\"lines\":" << lines
+        << ",\"statements\":" << statements
+        << ",\"tokens\":" << tokens
+        << ",\"symbolLookups\":{\"hits\":" << symbolHits << ",\"misses\":" << symbolMisses
+        << "},\"encodingCache\":{\"hits\":" << encodingHits << ",\"misses\":" << encodingMisses
+        << "},\"relocations\":" << relocations
+        << ",\"sectionBytes\":" << sectionBytes
+        << ",\"outputBytes\":" << outputBytes
+        << ",\"reusedSections\":" << reusedSections
+        << ",\"objectCache\":{\"hits\":" << objectCacheHits << ",\"misses\":" << objectCacheMisses << "}"
+        << ",\"allocations\":" << allocations
+        << ",\"allocatedBytes\":" << allocatedBytes
+        << "}\n";
+}
@@ -0,0 +1,67 @@
+#ifndef STATISTICS
+#define STATISTICS
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+/*
+ * Timings and counters of one assembly, collected
+ * when --stats is given. Counters can be updated
+ * from several threads at once.
+ */
+class Statistics{
+
+public:
+
+    Statistics();
+
+    static double elapsed(chrono::steady_clock::time_point);
+
+    static long getAllocations();
+
+    static long getAllocatedBytes();
+
+    static void countAllocation(size_t);
+
+    void countLookup(bool);
+
+    void writeJson(ostream&, const string&, const string&);
+
+    double firstPassTime;
+    double secondPassTime;
+    double outputTime;
+
+    double scanTime;
+    double mergeTime;
+    double encodeTime;
+    double writeTime;
+
+    long lines;
+    long statements;
+    atomic<long> tokens;
+    atomic<long> symbolHits;
+    atomic<long> symbolMisses;
+    atomic<long> encodingHits;
+    atomic<long> encodingMisses;
+    long relocations;
+    long sectionBytes;
+    long outputBytes;
+    long reusedSections;
+    long objectCacheHits;
+    long objectCacheMisses;
+    long allocations;
+    long allocatedBytes;
+    int threads;
+
+private:
+
+    static atomic<long> totalAllocations;
+    static atomic<long> totalAllocatedBytes;
+};
+
+#endif
@@ -1,62 +1,175 @@
 #include "StringTokenizer.h"
 #include <iostream>
 #include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
-StringTokenizer::StringTokenizer(char* line){
+/*
+ * Tokenizer works on a slice of the input that
+ * it doesn't own, so line doesn't have to be
+ * terminated with zero.
+ */
+StringTokenizer::StringTokenizer(const char* line, int length){
 
     this->line = line;
+    this->length = length;
     this->position = 0;
-    this->label = false;
+    this->numberOfTokens = 0;
 }
 
 StringTokenizer::~StringTokenizer(){
 
-    delete [] line;
-    line = nullptr;
 }
 
-bool StringTokenizer::wasLastTokenLabel(){
-
-    return label;
+/*
+ * Vector scans below never read past the end of
+ * the line: close to the end, sixteen bytes ending
+ * with the last one are loaded, and bits of bytes
+ * before the starting position are shifted out.
+ * Lines shorter than sixteen bytes are scanned
+ * one byte at a time.
+ */
+
+/*
+ * Returns position of the first byte at or after
+ * given one that is neither space nor new line, or
+ * length of the line if there is none.
+ */
+inline int StringTokenizer::findNonBlank(int from){
+
+    if(from < length && line[from] != ' ' && line[from] != '\n') return from;
+#ifdef __SSE2__
+    if(length >= 16){
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i newLine = _mm_set1_epi8('\n');
+        while(from < length){
+            int load = from + 16 <= length ? from : length - 16;
+            __m128i v = _mm_loadu_si128((const __m128i*)(line + load));
+            __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, newLine));
+            unsigned int mask = (~_mm_movemask_epi8(blank) & 0xFFFF) >> (from - load);
+            if(mask) return from + __builtin_ctz(mask);
+            from = load + 16;
+        }
+        return length;
+    }
+#endif
+    while(from < length && (line[from] == ' ' || line[from] == '\n')) from++;
+    return from;
 }
 
-char* StringTokenizer::getNextToken(){
-    while((line[position] == ' ' || line[position] == '\n') && line[position] != '\0') position++;
-
-    if(line[position] == '\0') return nullptr;
-
-    int length = 0;
-    bool isDelimiter = false;
-    char *tokenStartPosition = line + position;
-
-    while(line[position] != ':' && line[position] != ',' && line[position] != ' ' && line[position] != '\0'){
+/*
+ * Returns position of the first space, comma or
+ * colon at or after given position, or length of
+ * the line if there is none.
+ */
+inline int StringTokenizer::findDelimiter(int from){
 
-        position++;
-        length++;
+    /* most tokens are short, so first bytes are tested one by one */
+    for(int end = from + 4 < length ? from + 4 : length; from < end; from++){
+        if(line[from] == ':' || line[from] == ',' || line[from] == ' ') return from;
     }
+#ifdef __SSE2__
+    if(length >= 16){
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i colon = _mm_set1_epi8(':');
+        while(from < length){
+            int load = from + 16 <= length ? from : length - 16;
+            __m128i v = _mm_loadu_si128((const __m128i*)(line + load));
+            __m128i delimiter = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, comma)), _mm_cmpeq_epi8(v, colon));
+            unsigned int mask = _mm_movemask_epi8(delimiter) >> (from - load);
+            if(mask) return from + __builtin_ctz(mask);
+            from = load + 16;
+        }
+        return length;
+    }
+#endif
+    while(from < length && line[from] != ':' && line[from] != ',' && line[from] != ' ') from++;
+    return from;
+}
 
-    if(length == 0 && (line[position] == ':' || line[position] == ',')){
-            isDelimiter = true;
+/*
+ * This method returns next token in the line.
+ * Delimiters are spaces, commas and colons, and
+ * token followed by a colon is marked as label.
+ * Nothing is allocated, token points into the line.
+ */
+Token StringTokenizer::getNextToken(){
+
+    Token token;
+    while(true){
+        position = findNonBlank(position);
+
+        if(position >= length){
+            token.start = nullptr;
+            token.length = 0;
+            token.label = false;
+            token.delimiter = '\0';
+            return token;
+        }
+
+        token.start = line + position;
+        position = findDelimiter(position);
+        token.length = line + position - token.start;
+
+        /* lone comma or colon, skip it and look further */
+        if(token.length == 0){
             position++;
+            continue;
+        }
+
+        token.delimiter = position < length ? line[position] : '\0';
+        token.label = token.delimiter == ':';
+        numberOfTokens++;
+        return token;
     }
+}
 
-    if(isDelimiter) return getNextToken();
+/*
+ * Counts commas in the whole line. With SSE2
+ * each of sixteen byte counters is decreased by
+ * the compare result (minus one for a comma), and
+ * the counters are added up before any of them
+ * can overflow.
+ */
+int StringTokenizer::calculateNumberOfArguments(){
 
-    if(line[position] == ':') label = true;
-    else label = false;
+    int x = 0;
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i zero = _mm_setzero_si128();
+    while(i + 16 <= length){
+        __m128i counters = zero;
+        for(int n = 0; n < 255 && i + 16 <= length; n++, i += 16){
+            __m128i v = _mm_loadu_si128((const __m128i*)(line + i));
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(v, comma));
+        }
+        __m128i sums = _mm_sad_epu8(counters, zero);
+        x += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+    }
+#endif
+    for(; i < length; i++) if(line[i] == ',') x++;
+    return x;
+}
 
-    char *token = new char[length + 1];
-    for(int i = 0; i < length; i++) token[i] = tokenStartPosition[i];
-    token[length] = '\0';
+/*
+ * This method returns part of the line that
+ * hasn't been tokenized yet and its length.
+ */
+const char* StringTokenizer::getRestOfLine(int& restLength){
 
-    return token;
+    restLength = length - position;
+    return line + position;
 }
 
-int StringTokenizer::calculateNumberOfArguments(){
+/*
+ * Returns how many tokens were taken from the line.
+ */
+int StringTokenizer::getNumberOfTokens(){
 
-    int x = 0;
-    for(unsigned int i = 0; i < strlen(line); i++) if(line[i] == ',') x++;
-    return x;
+    return numberOfTokens;
 }
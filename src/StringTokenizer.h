@@ -1,27 +1,84 @@
 #ifndef STRINGTOKENIZER
 #define STRINGTOKENIZER
 
+#include <climits>
+
+/*
+ * Token is a view into the line it was found in,
+ * so it must not outlive that line, and it isn't
+ * terminated with zero: numbers in it are read
+ * with parseNumber, never with atoi, which would
+ * go on past blanks into the next token. Token with
+ * null start means there are no more tokens.
+ */
+struct Token{
+
+    const char *start;
+    int length;
+    bool label;
+    char delimiter;
+
+    explicit operator bool() const { return start != nullptr; }
+
+    char operator[](int i) const { return start[i]; }
+
+    /*
+     * Reads number starting at character first, like
+     * atoi would read the token on its own: optional
+     * sign, then digits up to the first other character
+     * or the end of the token. Gives zero when there
+     * are no digits and saturates like strtol.
+     */
+    long parseNumber(int first) const {
+
+        int i = first;
+        bool negative = false;
+        if(i < length && (start[i] == '-' || start[i] == '+')) negative = start[i++] == '-';
+        long x = 0;
+        for(; i < length && start[i] >= '0' && start[i] <= '9'; i++){
+            int digit = start[i] - '0';
+            if(x > (LONG_MAX - digit) / 10) return negative ? LONG_MIN : LONG_MAX;
+            x = x * 10 + digit;
+        }
+        return negative ? -x : x;
+    }
+};
+
+/*
+ * Splits a line into tokens. With SSE2 sixteen
+ * bytes of the line are compared with all the
+ * delimiters at once, and the end of a blank run
+ * or a token is the lowest bit of the mask.
+ */
 class StringTokenizer{
 
 public:
 
-    StringTokenizer(char*);
+    StringTokenizer(const char*, int);
 
     ~StringTokenizer();
 
-    char* getNextToken();
-
-    bool wasLastTokenLabel();
+    Token getNextToken();
 
     int calculateNumberOfArguments();
 
+    const char* getRestOfLine(int&);
+
+    int getNumberOfTokens();
+
 private:
 
-    char *line;
+    int findNonBlank(int);
 
-    bool label;
+    int findDelimiter(int);
+
+    const char *line;
+
+    int length;
 
     int position;
+
+    int numberOfTokens;
 };
 
 #endif
@@ -49,25 +49,6 @@ void Symbol::setNext(Symbol* next){
     this->next = next;
 }
 
-Symbol::Symbol(){
-    this->name = new char[10];
-    name[0] = 'U';
-	name[1] = 'N';
-	name[2] = 'D';
-	name[3] = 'E';
-	name[4] = 'F';
-	name[5] = 'I';
-	name[6] = 'N';
-	name[7] = 'E';
-	name[8] = 'D';
-	name[9] = '\0';
-    this->section = 0;
-    this->offset = 0;
-    this->visibility = 'l';
-    this->symbolNo = 0;
-    this->next = nullptr;
-}
-
 Symbol::Symbol(char* name, int section, int offset, char visibility, int symbolNo){
     this->name = name;
     this->section = section;
@@ -76,7 +57,3 @@ Symbol::Symbol(char* name, int section, int offset, char visibility, int symbolN
     this->symbolNo = symbolNo;
     this->next = nullptr;
 }
-
-Symbol::~Symbol(){
-    delete name;
-}
@@ -37,11 +37,7 @@ public:
 
     void setNext(Symbol*);
 
-    Symbol();
-
     Symbol(char*, int, int, char, int);
-
-    ~Symbol();
 };
 
 #endif
@@ -1,67 +1,188 @@
 #include "SymbolTable.h"
 #include "Symbol.h"
+#include "OutputBuffer.h"
+#include "Statistics.h"
 #include <cstring>
 #include <fstream>
-#include <iomanip>
+#include <new>
 
 using namespace std;
 
 SymbolTable::SymbolTable(){
-    first = last = lastSection = new Symbol();
-    counter = 1;
+    statistics = nullptr;
+    hashCapacity = 64;
+    hashTable = new Symbol*[hashCapacity];
+    clear();
 }
 
+/*
+ * Symbols and their names live in the arena,
+ * which frees them all at once.
+ */
 SymbolTable::~SymbolTable(){
-    while(first){
-        last = first;
-        first = first->getNext();
-        delete last;
+    first = lastSection = firstSymbol = last = nullptr;
+    delete [] hashTable;
+    hashTable = nullptr;
+}
+
+/*
+ * Removes all symbols but the undefined section.
+ * Hash table keeps its size and the arena keeps
+ * a block, so a table that is cleared for every
+ * small input stops allocating.
+ */
+void SymbolTable::clear(){
+    arena.reset();
+    hashSize = 0;
+    for(int i = 0; i < hashCapacity; i++) hashTable[i] = nullptr;
+    first = lastSection = createSymbol("UNDEFINED", 9, 0, 0, 'l', 0);
+    firstSymbol = last = nullptr;
+    insertIntoHashTable(first);
+}
+
+/*
+ * FNV-1a hash of a symbol name, used to index
+ * the open addressing table that sits next to
+ * the ordered list of symbols.
+ */
+unsigned int SymbolTable::hash(const char* name, int length){
+
+    unsigned int h = 2166136261u;
+    for(int i = 0; i < length; i++){
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Symbols and zero terminated copies of their
+ * names, which are passed in as views into the
+ * input, are placed in the arena.
+ */
+Symbol* SymbolTable::createSymbol(const char* name, int length, int section, int offset, char visibility, int symbolNo){
+
+    void *memory = arena.allocate(sizeof(Symbol), alignof(Symbol));
+    return new (memory) Symbol(arena.copyString(name, length), section, offset, visibility, symbolNo);
+}
+
+/*
+ * This method places symbol in the first free slot
+ * of its probe sequence. Table is kept at most half
+ * full so probe sequences stay short.
+ */
+void SymbolTable::insertIntoHashTable(Symbol* symbol){
+
+    if(2 * (hashSize + 1) > hashCapacity) growHashTable();
+    unsigned int mask = hashCapacity - 1;
+    unsigned int i = hash(symbol->getName(), strlen(symbol->getName())) & mask;
+    while(hashTable[i]) i = (i + 1) & mask;
+    hashTable[i] = symbol;
+    hashSize++;
+}
+
+/*
+ * This method doubles the capacity of hash table
+ * and reinserts all symbols.
+ */
+void SymbolTable::growHashTable(){
+
+    Symbol **oldTable = hashTable;
+    int oldCapacity = hashCapacity;
+    hashCapacity *= 2;
+    hashTable = new Symbol*[hashCapacity];
+    for(int i = 0; i < hashCapacity; i++) hashTable[i] = nullptr;
+    unsigned int mask = hashCapacity - 1;
+    for(int i = 0; i < oldCapacity; i++){
+        if(oldTable[i] == nullptr) continue;
+        unsigned int j = hash(oldTable[i]->getName(), strlen(oldTable[i]->getName())) & mask;
+        while(hashTable[j]) j = (j + 1) & mask;
+        hashTable[j] = oldTable[i];
     }
-    first = last = lastSection = nullptr;
+    delete [] oldTable;
 }
 
-void SymbolTable::addSymbol(char* name, int section, int offset, char visibility){
-    Symbol *newSymbol = new Symbol(name, section, offset, visibility, counter++);
-    last->setNext(newSymbol);
+/*
+ * Sections and other symbols are kept in two
+ * lists, so adding either is constant time.
+ * Symbols get their numbers, which come after
+ * numbers of all sections, in assignSymbolNumbers.
+ */
+void SymbolTable::addSymbol(const char* name, int length, int section, int offset, char visibility){
+    Symbol *newSymbol = createSymbol(name, length, section, offset, visibility, 0);
+    if(firstSymbol == nullptr) firstSymbol = newSymbol;
+    else last->setNext(newSymbol);
     last = newSymbol;
+    insertIntoHashTable(newSymbol);
 }
 
-void SymbolTable::addSection(char* name){
-    Symbol *newSymbol = new Symbol(name, lastSection->getSymbolNo() + 1, 0, 'l', lastSection->getSymbolNo() + 1);
+void SymbolTable::addSection(const char* name, int length){
+    Symbol *newSymbol = createSymbol(name, length, lastSection->getSymbolNo() + 1, 0, 'l', lastSection->getSymbolNo() + 1);
     newSymbol->setNext(lastSection->getNext());
     lastSection->setNext(newSymbol);
-    if(last == lastSection) last = newSymbol;
     lastSection = newSymbol;
-    while(newSymbol->getNext()){
-        newSymbol = newSymbol->getNext();
-        newSymbol->setSymbolNo(newSymbol->getSymbolNo() + 1);
-    }
-    counter++;
+    insertIntoHashTable(newSymbol);
+}
+
+/*
+ * This method is called at the end of the first
+ * pass. Symbols are numbered in order they were
+ * added, after the sections, and the symbol list
+ * is put after the section list.
+ */
+void SymbolTable::assignSymbolNumbers(){
+    int symbolNo = lastSection->getSymbolNo();
+    for(Symbol *s = firstSymbol; s; s = s->getNext()) s->setSymbolNo(++symbolNo);
+    lastSection->setNext(firstSymbol);
 }
 
-Symbol* SymbolTable::findSymbol(char* name){
-    Symbol *result = first;
-    while(result){
-        if(strcmp(name, result->getName()) == 0) break;
-        result = result->getNext();
+Symbol* SymbolTable::findSymbol(const char* name, int length){
+    unsigned int mask = hashCapacity - 1;
+    unsigned int i = hash(name, length) & mask;
+    while(hashTable[i]){
+        const char *candidate = hashTable[i]->getName();
+        if(strncmp(name, candidate, length) == 0 && candidate[length] == '\0'){
+            if(statistics) statistics->countLookup(true);
+            return hashTable[i];
+        }
+        i = (i + 1) & mask;
     }
-    return result;
+    if(statistics) statistics->countLookup(false);
+    return nullptr;
 }
 
-void SymbolTable::saveToFile(ofstream& file){
+void SymbolTable::saveToFile(OutputBuffer& file){
 
-    Symbol *tmp = first;
-    file << setw(10) << "SymbolNo" << setw(15) << "SymbolName" << setw(10) <<
-    "Section" << setw(10) << "Offset" << setw(15) << "Visibility" << endl << endl;
-    while(tmp){
-        file << setw(10) << tmp->getSymbolNo() << setw(15) << tmp->getName() << setw(10)
-        << tmp->getSection() << setw(10) << tmp->getOffset() << setw(15) << tmp->getVisibility()
-        << endl;
-        tmp = tmp->getNext();
+    file.appendRight("SymbolNo", 10);
+    file.appendRight("SymbolName", 15);
+    file.appendRight("Section", 10);
+    file.appendRight("Offset", 10);
+    file.appendRight("Visibility", 15);
+    file.append("\n\n");
+    for(Symbol *tmp = first; tmp; tmp = tmp->getNext()){
+        file.appendRight((long)tmp->getSymbolNo(), 10);
+        file.appendRight(tmp->getName(), 15);
+        file.appendRight((long)tmp->getSection(), 10);
+        file.appendRight((long)tmp->getOffset(), 10);
+        file.appendRight(tmp->getVisibility(), 15);
+        file.append('\n');
     }
 }
 
+/*
+ * Lookups are counted into statistics, if given.
+ */
+void SymbolTable::setStatistics(Statistics* statistics){
+
+    this->statistics = statistics;
+}
+
 int SymbolTable::getLastSectionID(){
 
     return lastSection->getSymbolNo();
 }
+
+Symbol* SymbolTable::getFirst(){
+
+    return first;
+}
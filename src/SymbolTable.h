@@ -2,17 +2,38 @@
 #define SYMBOLTABLE
 
 #include <fstream>
+#include "Arena.h"
 
 using namespace std;
 
 class Symbol;
 
+class OutputBuffer;
+
+class Statistics;
+
 class SymbolTable{
 
 private:
 
-    Symbol *first, *last, *lastSection;
-    int counter;
+    Symbol *first, *lastSection;
+    Symbol *firstSymbol, *last;
+
+    Arena arena;
+
+    Statistics *statistics;
+
+    Symbol **hashTable;
+    int hashCapacity;
+    int hashSize;
+
+    static unsigned int hash(const char*, int);
+
+    void insertIntoHashTable(Symbol*);
+
+    void growHashTable();
+
+    Symbol* createSymbol(const char*, int, int, int, char, int);
 
 public:
 
@@ -20,15 +41,23 @@ public:
 
     ~SymbolTable();
 
-    void addSymbol(char*, int, int, char);
+    void clear();
+
+    void addSymbol(const char*, int, int, int, char);
 
-    void addSection(char*);
+    void addSection(const char*, int);
 
-    Symbol* findSymbol(char*);
+    void assignSymbolNumbers();
 
-    void saveToFile(ofstream&);
+    Symbol* findSymbol(const char*, int);
+
+    void saveToFile(OutputBuffer&);
+
+    void setStatistics(Statistics*);
 
     int getLastSectionID();
+
+    Symbol* getFirst();
 };
 
 #endif
@@ -0,0 +1,296 @@
+#include "Assembly.h"
+#include "Error.h"
+#include "Statistics.h"
+#include "SymbolTable.h"
+#include "RelocationTable.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+/*
+ * Benchmark of the assembler on a synthetic program.
+ * Program has given number of instructions spread over
+ * sections, with labels among them, and mixes plain
+ * instructions with .long symbol expressions, ldc of
+ * symbols and .skip. With -u, instructions are drawn
+ * from that many distinct lines, like repetitive
+ * compiler output. Time of each pass and of writing
+ * output is reported as throughput. With -s, many
+ * small snippets are assembled in memory instead,
+ * once with an assembly made for each snippet and
+ * once with one assembly reused for all of them,
+ * after checking that both give the same code.
+ */
+
+static const char *conditions[] = {"eq", "ne", "gt", "ge", "lt", "le", "al"};
+
+static const char *sectionKinds[] = {"text", "data", "bss"};
+
+static string label(int i){
+
+    return "L" + to_string(i);
+}
+
+static string reg(int limit){
+
+    return "R" + to_string(rand() % (limit + 1));
+}
+
+/*
+ * Writes program with instructions lines, labels labels
+ * and sections sections into file. Unless distinct is
+ * zero, each line is generated from one of distinct
+ * seeds. Returns number of lines written.
+ */
+static long generate(const char* fileName, long instructions, long labels, int sections, long distinct){
+
+    ofstream file(fileName);
+    file << ".extern ex0, ex1\n";
+    long lines = 1;
+
+    long nextLabel = 0;
+    for(long i = 0; i < instructions; i++){
+        if(i % ((instructions + sections - 1) / sections) == 0){
+            file << "." << sectionKinds[i % 3] << ".s" << i << "\n";
+            lines++;
+        }
+        /* labels are spread evenly over instructions */
+        if(nextLabel < labels && nextLabel * instructions <= i * labels){
+            file << label(nextLabel++) << ":\n";
+            lines++;
+        }
+        if(distinct > 0) srand(1 + i * 2654435761u % distinct);
+        string c = conditions[rand() % 7];
+        int r = rand() % 20;
+        if(r < 2 && labels > 0) file << ".long #" << rand() % 100000 << ", " << label(rand() % labels) << " + " << label(rand() % labels) << "\n";
+        else if(r < 4) file << "ldc" << c << " " << reg(15) << ", " << (labels > 0 && rand() % 8 ? label(rand() % labels) : "ex0") << "\n";
+        else if(r < 5) file << ".skip " << rand() % 16 << "\n";
+        else if(r < 8) file << "add" << c << " " << reg(18) << ", #" << rand() % 1000 << "\n";
+        else if(r < 11) file << "mov" << c << " " << reg(15) << ", " << reg(15) << "\n";
+        else if(r < 13) file << "ldr" << c << " " << reg(15) << ", " << reg(15) << ", #" << 2 + rand() % 4 << ", #" << rand() % 500 << "\n";
+        else if(r < 15) file << "shl" << c << " " << reg(15) << ", " << reg(15) << ", #" << rand() % 32 << "\n";
+        else if(r < 17) file << "cmp" << c << " " << reg(15) << ", " << reg(15) << "\n";
+        else if(r < 18) file << "ldcl" << c << " " << reg(15) << ", #" << rand() % 60000 << "\n";
+        else file << "int" << c << " " << rand() % 16 << "\n";
+        lines++;
+    }
+    file << ".end\n";
+    lines++;
+    return lines;
+}
+
+static long fileSize(const char* fileName){
+
+    ifstream file(fileName, ifstream::binary | ifstream::ate);
+    return file.is_open() ? (long)file.tellg() : 0;
+}
+
+static double seconds(chrono::steady_clock::time_point start){
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/*
+ * Makes snippets of a few instructions each, the
+ * way a JIT or a test harness hands them over.
+ */
+static vector<string> generateSnippets(long count, long instructions){
+
+    vector<string> snippets;
+    for(long i = 0; i < count; i++){
+        ostringstream snippet;
+        snippet << ".public f" << i << "\n.text.f" << i << "\nf" << i << ":\n";
+        for(long j = 0; j < instructions; j++){
+            string c = conditions[rand() % 7];
+            int r = rand() % 6;
+            if(r == 0) snippet << "add" << c << " " << reg(15) << ", #" << rand() % 1000 << "\n";
+            else if(r == 1) snippet << "mov" << c << " " << reg(15) << ", " << reg(15) << "\n";
+            else if(r == 2) snippet << "ldc" << c << " " << reg(15) << ", f" << i << "\n";
+            else if(r == 3) snippet << "cmp" << c << " " << reg(15) << ", " << reg(15) << "\n";
+            else if(r == 4) snippet << "ldr" << c << " " << reg(15) << ", " << reg(15) << ", #2, #" << rand() % 500 << "\n";
+            else snippet << "int" << c << " " << rand() % 16 << "\n";
+        }
+        snippet << ".data.d" << i << "\n.long f" << i << ", #" << rand() % 1000 << "\n.end\n";
+        snippets.push_back(snippet.str());
+    }
+    return snippets;
+}
+
+/*
+ * Assembles every snippet, with a new assembly for
+ * each one or with the same one. Returns seconds
+ * taken.
+ */
+static double assembleSnippets(const vector<string>& snippets, bool reuse){
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Assembly *shared = reuse ? new Assembly() : nullptr;
+    for(size_t i = 0; i < snippets.size(); i++){
+        Assembly *a = reuse ? shared : new Assembly();
+        a->assemble(snippets[i].data(), snippets[i].size());
+        if(!reuse) delete a;
+    }
+    delete shared;
+    return seconds(start);
+}
+
+/*
+ * Checks that two assemblies made the same bytes
+ * and relocations in every section.
+ */
+static bool sameCode(Assembly& a, Assembly& b){
+
+    if(a.getNumberOfSections() != b.getNumberOfSections()) return false;
+    for(int i = 0; i < a.getNumberOfSections(); i++){
+        MachineCode &x = a.getSectionCode(i);
+        MachineCode &y = b.getSectionCode(i);
+        if(x.getSize() != y.getSize() || (x.getSize() && memcmp(x.getData(), y.getData(), x.getSize()) != 0)) return false;
+        RelocationTable *r = a.getRelocationTable(i);
+        RelocationTable *t = b.getRelocationTable(i);
+        if(r->getSize() != t->getSize()) return false;
+        for(int j = 0; j < r->getSize(); j++){
+            if(r->getOffset(j) != t->getOffset(j) || r->getType(j) != t->getType(j) || r->getValue(j) != t->getValue(j)) return false;
+        }
+    }
+    return true;
+}
+
+static void report(const char* phase, double time, long lines, long bytes){
+
+    cout << phase << time * 1000 << " ms, " << lines / time << " lines/s, " << bytes / time << " bytes/s" << endl;
+}
+
+int main(int argc, char* argv[]){
+
+    long instructions = 1000000;
+    long labels = 100000;
+    int sections = 16;
+    int numberOfThreads = 1;
+    int repeat = 3;
+    long distinct = 0;
+    long snippets = 0;
+    bool binaryOutput = false;
+    const char *input = "bench_input.s";
+    const char *output = "bench_output.txt";
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) instructions = atol(argv[++i]);
+        else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) labels = atol(argv[++i]);
+        else if(strcmp(argv[i], "-k") == 0 && i + 1 < argc) sections = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) numberOfThreads = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-u") == 0 && i + 1 < argc) distinct = atol(argv[++i]);
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) snippets = atol(argv[++i]);
+        else if(strcmp(argv[i], "--format=bin") == 0) binaryOutput = true;
+        else{
+            cout << "Usage: bench [-n instructions] [-m labels] [-k sections] [-j threads] [-r repeat] [-u distinct] [-s snippets] [--format=bin]" << endl;
+            return 1;
+        }
+    }
+    if(instructions < 1) instructions = 1;
+    if(sections < 1) sections = 1;
+    if(labels > instructions) labels = instructions;
+
+    srand(1);
+    if(snippets > 0){
+        /* -n is the number of instructions in a snippet here */
+        vector<string> code = generateSnippets(snippets, min(instructions, 64L));
+        double fresh = 0, reused = 0;
+        try{
+            /* reused assembly must give what a new one gives, snippet by snippet */
+            Assembly shared;
+            for(size_t i = 0; i < code.size(); i++){
+                Assembly single;
+                shared.assemble(code[i].data(), code[i].size());
+                single.assemble(code[i].data(), code[i].size());
+                if(!sameCode(shared, single)){
+                    cout << "Error: reused assembly gave different code" << endl;
+                    return 1;
+                }
+            }
+            for(int i = 0; i < repeat; i++){
+                double t1 = assembleSnippets(code, false);
+                double t2 = assembleSnippets(code, true);
+                if(i == 0 || t1 < fresh) fresh = t1;
+                if(i == 0 || t2 < reused) reused = t2;
+            }
+        }catch(Error &e){
+            cout << e.toString() << endl;
+            return 1;
+        }
+        cout << "snippets: " << snippets << ", instructions each: " << min(instructions, 64L) << endl;
+        cout << "new assembly each: " << snippets / fresh << " snippets/s" << endl;
+        cout << "reused assembly:   " << snippets / reused << " snippets/s" << endl;
+        return 0;
+    }
+
+    long lines = generate(input, instructions, labels, sections, distinct);
+    long inputBytes = fileSize(input);
+    cout << "instructions: " << instructions << ", labels: " << labels << ", sections: " << sections
+         << ", threads: " << numberOfThreads << ", lines: " << lines << ", input bytes: " << inputBytes << endl;
+
+    /* best of repeated runs */
+    double first = 0, second = 0, writing = 0;
+    long outputBytes = 0;
+    for(int i = 0; i < repeat; i++){
+        try{
+            Assembly a(input, output);
+            a.setBinaryOutput(binaryOutput);
+            a.setNumberOfThreads(numberOfThreads);
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            a.firstPass();
+            double t1 = seconds(start);
+            start = chrono::steady_clock::now();
+            a.secondPass();
+            double t2 = seconds(start);
+            start = chrono::steady_clock::now();
+            a.createOutputFile();
+            double t3 = seconds(start);
+            if(i == 0 || t1 < first) first = t1;
+            if(i == 0 || t2 < second) second = t2;
+            if(i == 0 || t3 < writing) writing = t3;
+        }catch(Error &e){
+            cout << e.toString() << endl;
+            return 1;
+        }
+        outputBytes = fileSize(output);
+    }
+
+    /* hit rate comes from one more run, so counting doesn't slow down timed runs */
+    Statistics statistics;
+    try{
+        Assembly a(input, output);
+        a.setStatistics(&statistics);
+        a.setNumberOfThreads(numberOfThreads);
+        a.firstPass();
+        a.secondPass();
+    }catch(Error &e){
+        cout << e.toString() << endl;
+        return 1;
+    }
+    long encodingHits = statistics.encodingHits;
+    long encodingMisses = statistics.encodingMisses;
+
+    report("first pass:  ", first, lines, inputBytes);
+    report("second pass: ", second, lines, inputBytes);
+    report("output:      ", writing, lines, outputBytes);
+    report("total:       ", first + second + writing, lines, inputBytes);
+    if(encodingHits + encodingMisses > 0){
+        cout << "encoding cache: " << encodingHits << " hits, " << encodingMisses << " misses, "
+             << 100.0 * encodingHits / (encodingHits + encodingMisses) << "% hit rate" << endl;
+    }
+
+    remove(input);
+    remove(output);
+    return 0;
+}
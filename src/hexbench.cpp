@@ -0,0 +1,76 @@
+#include "HexFormatter.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+
+/*
+ * Micro-benchmark of hexadecimal formatting of
+ * section bytes. Compares the routine text output
+ * used to have (digit by digit into a string)
+ * with the lookup table and SSE2 kernels.
+ */
+
+static string convertDecimalToHex(unsigned long long decimal, int b){
+
+    string result = "";
+    for(int i = 0; i < 2 * b; i++){
+        unsigned long long tmp = decimal & 15;
+        tmp += tmp >= 10 ? 55 : 48;
+        result = (char)tmp + result;
+        decimal >>= 4;
+    }
+    return result;
+}
+
+static void formatOld(const vector<unsigned char>& bytes, string& out){
+
+    out.clear();
+    for(size_t i = 0; i < bytes.size(); i++){
+        out += convertDecimalToHex(bytes[i], 1);
+        out += ' ';
+        if(i % 8 == 7) out += '\n';
+    }
+}
+
+template<class F> static double measure(F f, int repeat){
+
+    f();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i = 0; i < repeat; i++) f();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / repeat;
+}
+
+int main(int argc, char *argv[]){
+
+    size_t size = argc > 1 ? atol(argv[1]) : 1 << 24;
+    int repeat = argc > 2 ? atoi(argv[2]) : 10;
+
+    vector<unsigned char> bytes(size);
+    srand(1);
+    for(size_t i = 0; i < size; i++) bytes[i] = rand();
+
+    string old;
+    string scalar(HexFormatter::getFormattedSize(size), '\0');
+    string kernel(HexFormatter::getFormattedSize(size), '\0');
+
+    double oldTime = measure([&](){ formatOld(bytes, old); }, repeat);
+    double scalarTime = measure([&](){ HexFormatter::formatBytesScalar(&bytes[0], size, &scalar[0]); }, repeat);
+    double kernelTime = measure([&](){ HexFormatter::formatBytes(&bytes[0], size, &kernel[0]); }, repeat);
+
+    if(old != scalar || old != kernel){
+        cout << "Error: formatted output differs" << endl;
+        return 1;
+    }
+
+    double megabytes = size / 1e6;
+    cout << "bytes: " << size << ", repeat: " << repeat << endl;
+    cout << "digit by digit: " << megabytes / oldTime << " MB/s" << endl;
+    cout << "lookup table:   " << megabytes / scalarTime << " MB/s" << endl;
+    cout << "kernel:         " << megabytes / kernelTime << " MB/s" << endl;
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "StringTokenizer.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+
+/*
+ * Micro-benchmark of the tokenizer on lines with
+ * long operand lists. Compares the tokenizer that
+ * tested one byte at a time against each delimiter
+ * with the one that compares sixteen bytes at once.
+ * Both must find the same tokens and commas.
+ * Old tokenizer is hidden from interprocedural
+ * optimization, as if it were in its own translation
+ * unit like the real one; otherwise the compiler
+ * sees it has no side effects and runs it once for
+ * all repetitions.
+ */
+
+struct OldTokenizer{
+
+    const char *line;
+    int length;
+    int position;
+
+    OldTokenizer(const char* line, int length) : line(line), length(length), position(0) {}
+
+    __attribute__((noipa)) Token getNextToken(){
+
+        Token token;
+        while(true){
+            while(position < length && (line[position] == ' ' || line[position] == '\n')) position++;
+
+            if(position >= length){
+                token.start = nullptr;
+                token.length = 0;
+                token.label = false;
+                token.delimiter = '\0';
+                return token;
+            }
+
+            token.start = line + position;
+            while(position < length && line[position] != ':' && line[position] != ',' && line[position] != ' ') position++;
+            token.length = line + position - token.start;
+
+            if(token.length == 0){
+                position++;
+                continue;
+            }
+
+            token.delimiter = position < length ? line[position] : '\0';
+            token.label = token.delimiter == ':';
+            return token;
+        }
+    }
+
+    __attribute__((noipa)) int calculateNumberOfArguments(){
+
+        int x = 0;
+        for(int i = 0; i < length; i++) if(line[i] == ',') x++;
+        return x;
+    }
+};
+
+/*
+ * Counts commas and sums token lengths, the way
+ * the first pass goes through a directive.
+ */
+template<class T> static long tokenize(const vector<string>& lines){
+
+    long sum = 0;
+    for(size_t i = 0; i < lines.size(); i++){
+        T tokenizer(lines[i].data(), lines[i].size());
+        sum += tokenizer.calculateNumberOfArguments();
+        for(Token t = tokenizer.getNextToken(); t; t = tokenizer.getNextToken()) sum += t.length * 3 + t.label + t.delimiter;
+    }
+    return sum;
+}
+
+/*
+ * Checks that both tokenizers split the line
+ * into the same tokens.
+ */
+static bool sameTokens(const string& line){
+
+    OldTokenizer a(line.data(), line.size());
+    StringTokenizer b(line.data(), line.size());
+    if(a.calculateNumberOfArguments() != b.calculateNumberOfArguments()) return false;
+    while(true){
+        Token x = a.getNextToken();
+        Token y = b.getNextToken();
+        if(x.start != y.start || x.length != y.length || x.label != y.label || x.delimiter != y.delimiter) return false;
+        if(!x) return true;
+    }
+}
+
+template<class F> static double measure(F f, int repeat){
+
+    f();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i = 0; i < repeat; i++) f();
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / repeat;
+}
+
+int main(int argc, char *argv[]){
+
+    int numberOfLines = argc > 1 ? atoi(argv[1]) : 10000;
+    int operands = argc > 2 ? atoi(argv[2]) : 64;
+    int repeat = argc > 3 ? atoi(argv[3]) : 10;
+
+    /* .long and .char lines, and some short instructions in between */
+    vector<string> lines;
+    long bytes = 0;
+    srand(1);
+    for(int i = 0; i < numberOfLines; i++){
+        string line;
+        int kind = rand() % 4;
+        if(kind == 0){
+            line = "label" + to_string(i) + ": .long ";
+            for(int j = 0; j < operands; j++){
+                if(j) line += ", ";
+                if(rand() % 2) line += "#" + to_string(rand() % 100000);
+                else line += "symbol" + to_string(rand() % 1000);
+            }
+        }else if(kind == 1){
+            line = ".char ";
+            for(int j = 0; j < operands; j++){
+                if(j) line += rand() % 2 ? ", " : ",";
+                line += (char)('a' + rand() % 26);
+            }
+        }else if(kind == 2){
+            line = ".long ";
+            for(int j = 0; j < operands; j++){
+                if(j) line += ", ";
+                line += "external_data_table_entry_" + to_string(rand() % 1000);
+            }
+        }else line = "addeq R1, #" + to_string(rand() % 1000);
+        bytes += line.size();
+        lines.push_back(line);
+    }
+
+    long oldSum = 0, newSum = 0;
+    double oldTime = measure([&](){ oldSum = tokenize<OldTokenizer>(lines); }, repeat);
+    double newTime = measure([&](){ newSum = tokenize<StringTokenizer>(lines); }, repeat);
+
+    /* lines of every length, with delimiters next to each other */
+    const char alphabet[] = " ,:\nab#1";
+    for(int i = 0; i < 100000; i++){
+        string line;
+        int length = rand() % 200;
+        for(int j = 0; j < length; j++) line += alphabet[rand() % 8];
+        if(!sameTokens(line)) oldSum = -1;
+    }
+
+    if(oldSum != newSum){
+        cout << "Error: tokens differ" << endl;
+        return 1;
+    }
+
+    double megabytes = bytes / 1e6;
+    cout << "lines: " << numberOfLines << ", operands: " << operands << ", repeat: " << repeat << endl;
+    cout << "byte at a time: " << megabytes / oldTime << " MB/s" << endl;
+    cout << "sixteen bytes:  " << megabytes / newTime << " MB/s" << endl;
+    return 0;
+}
@@ -1,22 +1,301 @@
 #include <iostream>
-#include "StringTokenizer.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
 #include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <new>
 #include "Assembly.h"
 #include "Error.h"
-#include <sstream>
+#include "Statistics.h"
+#include "ObjectCache.h"
+#include <sys/stat.h>
 
 using namespace std;
 
-int main(int argc, char* argv[]){
+/* set before any job starts, when --stats is given */
+static bool countAllocations = false;
+
+/*
+ * Allocator of the assembler program counts heap
+ * allocations for --stats. It is here rather than
+ * in the library, so programs that only link the
+ * assembler keep their own allocator. Every
+ * allocation of the process is counted, so numbers
+ * taken around a phase are only exact when nothing
+ * else runs at the same time. Nothrow forms are
+ * replaced as well, so every form of new is paired
+ * with this delete. Functions are not inlined: the
+ * compiler would then see free of memory it thinks
+ * came from the standard operator new.
+ */
+static void* allocate(size_t size){
+
+    if(countAllocations) Statistics::countAllocation(size);
+    return malloc(size ? size : 1);
+}
+
+__attribute__((noinline)) void* operator new(size_t size){
+
+    void *memory = allocate(size);
+    if(memory == nullptr) throw bad_alloc();
+    return memory;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size){
+
+    void *memory = allocate(size);
+    if(memory == nullptr) throw bad_alloc();
+    return memory;
+}
+
+__attribute__((noinline)) void* operator new(size_t size, const nothrow_t&) noexcept{
+
+    return allocate(size);
+}
+
+__attribute__((noinline)) void* operator new[](size_t size, const nothrow_t&) noexcept{
+
+    return allocate(size);
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept{
+
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete[](void* memory) noexcept{
+
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, const nothrow_t&) noexcept{
+
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete[](void* memory, const nothrow_t&) noexcept{
+
+    free(memory);
+}
+
+/*
+ * One input file and the output it is assembled
+ * into, plus the error message if it failed.
+ */
+struct Job{
+
+    string input;
+    string output;
+    string error;
+    string statistics;
+    string cache;
+};
+
+/*
+ * True for standard input or output and for files
+ * that aren't regular, like pipes, which can only
+ * be read or written once.
+ */
+static bool isStream(const string& fileName){
+
+    struct stat info;
+    if(fileName == "-") return true;
+    return stat(fileName.c_str(), &info) == 0 && !S_ISREG(info.st_mode);
+}
+
+/*
+ * Assembles one file. Every job has its own
+ * Assembly instance, so jobs can run concurrently.
+ * Threads given here are used inside the job.
+ * Statistics are kept as a line of JSON. In
+ * incremental mode results are cached in a file
+ * named after the output. With an object cache,
+ * input that was assembled before is not assembled
+ * again, its output is copied from the cache.
+ * Jobs that read or write a stream skip the object
+ * cache, since a stream can't be read twice. Jobs
+ * writing standard output skip the incremental
+ * cache too, there is no file to name it after.
+ */
+static void runJob(Job& job, bool binaryOutput, int numberOfThreads, bool collectStatistics, bool incremental, bool pipeline, ObjectCache* objectCache){
 
     try{
-        Assembly *a = new Assembly(argv[1], argv[2]);
-        a->firstPass();
-        a->secondPass();
-        delete a;
+        Statistics statistics;
+        string key;
+        if(objectCache && !isStream(job.input) && !isStream(job.output)){
+            InputFile input;
+            if(input.open(job.input.c_str())) key = objectCache->makeKey(input.getData(), input.getSize(), binaryOutput);
+            if(!key.empty() && objectCache->fetch(key, job.output.c_str())){
+                statistics.objectCacheHits = 1;
+                if(collectStatistics){
+                    ostringstream json;
+                    statistics.writeJson(json, job.input, job.output);
+                    job.statistics = json.str();
+                }
+                return;
+            }
+            statistics.objectCacheMisses = 1;
+        }
+        /* output is cached only after createOutputFile closed it without errors */
+        {
+            Assembly a(job.input.c_str(), job.output.c_str());
+            a.setBinaryOutput(binaryOutput);
+            a.setNumberOfThreads(numberOfThreads);
+            a.setPipeline(pipeline);
+            if(collectStatistics) a.setStatistics(&statistics);
+            if(incremental && job.output != "-"){
+                job.cache = job.output + ".cache";
+                a.setCacheFile(job.cache.c_str());
+            }
+            a.firstPass();
+            a.secondPass();
+            a.createOutputFile();
+        }
+        if(!key.empty()) objectCache->store(key, job.output.c_str());
+        if(collectStatistics){
+            ostringstream json;
+            statistics.writeJson(json, job.input, job.output);
+            job.statistics = json.str();
+        }
     }catch(Error &e){
-        cout << e.toString() << endl;
+        job.error = e.toString();
+    }
+}
+
+/*
+ * Reads pairs of input and output file names
+ * separated by whitespace from manifest file.
+ */
+static bool readManifest(const char* fileName, vector<Job>& jobs){
+
+    ifstream manifest(fileName);
+    if(!manifest.is_open()) return false;
+    Job job;
+    while(manifest >> job.input >> job.output) jobs.push_back(job);
+    return true;
+}
+
+/* size limit of object cache when none is given, in bytes */
+static const long DEFAULT_CACHE_SIZE = 256l << 20;
+
+static void printUsage(){
+
+    cout << "Usage: assembly [--format=text|--format=bin] [-j N] [--pipeline] [--stats[=file]] [--incremental] [--cache-dir=dir [--cache-size=MB]] input output [input output ...]" << endl;
+    cout << "       assembly [--format=text|--format=bin] [-j N] [--pipeline] [--stats[=file]] [--incremental] [--cache-dir=dir [--cache-size=MB]] --manifest=file" << endl;
+    cout << "Input or output named - is standard input or output." << endl;
+}
+
+int main(int argc, char* argv[]){
+
+    bool binaryOutput = false;
+    bool collectStatistics = false;
+    bool incremental = false;
+    bool pipeline = false;
+    const char *statisticsFile = nullptr;
+    const char *cacheDirectory = nullptr;
+    long cacheSize = DEFAULT_CACHE_SIZE;
+    int numberOfThreads = thread::hardware_concurrency();
+    vector<Job> jobs;
+    vector<char*> files;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--format=bin") == 0) binaryOutput = true;
+        else if(strcmp(argv[i], "--format=text") == 0) binaryOutput = false;
+        else if(strcmp(argv[i], "--incremental") == 0) incremental = true;
+        else if(strcmp(argv[i], "--pipeline") == 0) pipeline = true;
+        else if(strcmp(argv[i], "--stats") == 0) collectStatistics = true;
+        else if(strncmp(argv[i], "--stats=", 8) == 0){
+            collectStatistics = true;
+            statisticsFile = argv[i] + 8;
+        }
+        else if(strncmp(argv[i], "--cache-dir=", 12) == 0) cacheDirectory = argv[i] + 12;
+        else if(strncmp(argv[i], "--cache-size=", 13) == 0) cacheSize = atol(argv[i] + 13) << 20;
+        else if(strncmp(argv[i], "--manifest=", 11) == 0){
+            if(!readManifest(argv[i] + 11, jobs)){
+                cout << "Error opening manifest file." << endl;
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "-j") == 0 && i + 1 < argc) numberOfThreads = atoi(argv[++i]);
+        else if(strncmp(argv[i], "-j", 2) == 0 && argv[i][2] != '\0') numberOfThreads = atoi(argv[i] + 2);
+        else files.push_back(argv[i]);
+    }
+    if(files.size() % 2 != 0 || (files.empty() && jobs.empty())){
+        printUsage();
+        return 1;
+    }
+    for(unsigned int i = 0; i < files.size(); i += 2){
+        Job job;
+        job.input = files[i];
+        job.output = files[i + 1];
+        jobs.push_back(job);
+    }
+
+    /* one stream can't be shared by jobs; messages move to stderr when stdout is output */
+    int standardInputs = 0, standardOutputs = 0;
+    for(unsigned int i = 0; i < jobs.size(); i++){
+        if(jobs[i].input == "-") standardInputs++;
+        if(jobs[i].output == "-") standardOutputs++;
+    }
+    ostream &messages = standardOutputs > 0 ? cerr : cout;
+    if(standardInputs > 1 || standardOutputs > 1){
+        messages << "Error: only one job can use standard input or output." << endl;
+        return 1;
+    }
+
+    if(numberOfThreads < 1) numberOfThreads = 1;
+    countAllocations = collectStatistics;
+
+    ObjectCache *objectCache = nullptr;
+    if(cacheDirectory) objectCache = new ObjectCache(cacheDirectory, cacheSize);
+
+    /* single file uses the threads for its sections instead */
+    int threadsPerJob = 1;
+    if(jobs.size() == 1) threadsPerJob = numberOfThreads;
+    if(numberOfThreads > (int)jobs.size()) numberOfThreads = jobs.size();
+
+    /* workers take jobs in order until none are left */
+    atomic<unsigned int> nextJob(0);
+    vector<thread> workers;
+    for(int i = 1; i < numberOfThreads; i++){
+        workers.push_back(thread([&](){
+            for(unsigned int j = nextJob++; j < jobs.size(); j = nextJob++) runJob(jobs[j], binaryOutput, threadsPerJob, collectStatistics, incremental, pipeline, objectCache);
+        }));
+    }
+    for(unsigned int j = nextJob++; j < jobs.size(); j = nextJob++) runJob(jobs[j], binaryOutput, threadsPerJob, collectStatistics, incremental, pipeline, objectCache);
+    for(unsigned int i = 0; i < workers.size(); i++) workers[i].join();
+
+    /* errors are reported in order of jobs, not completion */
+    bool failed = false;
+    for(unsigned int i = 0; i < jobs.size(); i++){
+        if(jobs[i].error.empty()) continue;
+        failed = true;
+        if(jobs.size() == 1) messages << jobs[i].error << endl;
+        else messages << jobs[i].input << ": " << jobs[i].error << endl;
+    }
+
+    /* statistics go to stderr or to given file, one line per job */
+    if(collectStatistics){
+        ofstream file;
+        if(statisticsFile){
+            file.open(statisticsFile);
+            if(!file.is_open()){
+                messages << "Error opening statistics file." << endl;
+                return 1;
+            }
+        }
+        ostream &out = statisticsFile ? (ostream&)file : cerr;
+        for(unsigned int i = 0; i < jobs.size(); i++) out << jobs[i].statistics;
+        if(objectCache){
+            out << "{\"objectCache\":{\"hits\":" << objectCache->getHits() << ",\"misses\":" << objectCache->getMisses()
+                << ",\"evictions\":" << objectCache->getEvictions() << "}}\n";
+        }
     }
+    delete objectCache;
 
-    return 0;
+    return failed ? 1 : 0;
 }